@@ -719,9 +719,16 @@ ApplicationWindow {
                     Loader { id: fbFwDlg; active: false; sourceComponent: Component { FolderDialog {
                         onAccepted: { fastbootController.loadFirmwareDir(selectedFolder.toString().replace("file:///","")); fbFwDlg.active=false }
                         onRejected: fbFwDlg.active=false; Component.onCompleted: open() } }}
-                    Loader { id: fbPayDlg; active: false; sourceComponent: Component { FileDialog { nameFilters: ["Payload (payload.bin)", "All (*)"]
+                    Loader { id: fbPayDlg; active: false; sourceComponent: Component { FileDialog { nameFilters: ["Payload (payload.bin *.zip)", "All (*)"]
                         onAccepted: { fastbootController.loadPayload(selectedFile.toString().replace("file:///","")); fbPayDlg.active=false }
                         onRejected: fbPayDlg.active=false; Component.onCompleted: open() } }}
+                    Loader { id: fbSrcDlg; active: false; sourceComponent: Component { FolderDialog {
+                        onAccepted: { fastbootController.setPayloadSourceDir(selectedFolder.toString().replace("file:///","")); fbSrcDlg.active=false }
+                        onRejected: fbSrcDlg.active=false; Component.onCompleted: open() } }}
+                    Loader { id: fbExtDlg; active: false; sourceComponent: Component { FolderDialog {
+                        onAccepted: { var n=[]; var ps=fastbootController.partitions; for(var i=0;i<ps.length;i++) if(ps[i].checked&&ps[i].fromPayload) n.push(ps[i].name)
+                            fastbootController.extractPayloadPartitions(n, selectedFolder.toString().replace("file:///","")); fbExtDlg.active=false }
+                        onRejected: fbExtDlg.active=false; Component.onCompleted: open() } }}
 
                     Rectangle { anchors.fill: parent; color: bg0
                     ColumnLayout { anchors.fill: parent; anchors.margins: 14; spacing: 10
@@ -733,6 +740,9 @@ ApplicationWindow {
                             Item { Layout.fillWidth: true }
                             FilePick { label: curLang===0?"镜像":"Images"; onClicked: fbImgDlg.active=true }
                             FilePick { label: "Payload"; ready: fastbootController.payloadLoaded; onClicked: fbPayDlg.active=true }
+                            ChkToggle { label: curLang===0?"校验":"Verify"; visible: fastbootController.payloadLoaded; checked: fastbootController.payloadVerify; onToggled: fastbootController.payloadVerify=!fastbootController.payloadVerify }
+                            FilePick { label: curLang===0?"源镜像":"Base Dir"; visible: fastbootController.payloadLoaded; onClicked: fbSrcDlg.active=true }
+                            FilePick { label: curLang===0?"提取":"Extract"; visible: fastbootController.payloadLoaded&&fastbootController.hasCheckedPartitions&&!fastbootController.isBusy; onClicked: fbExtDlg.active=true }
                             FilePick { label: curLang===0?"固件":"FW Dir"; onClicked: fbFwDlg.active=true }
                         }
                         Item { Layout.fillWidth: true; Layout.fillHeight: true
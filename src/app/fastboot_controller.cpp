@@ -1,5 +1,6 @@
 #include "fastboot_controller.h"
 #include "fastboot/services/fastboot_service.h"
+#include "fastboot/parsers/payload_extractor.h"
 #include "fastboot/parsers/payload_parser.h"
 #include "core/logger.h"
 #include <QtConcurrent>
@@ -201,6 +202,7 @@ void FastbootController::loadPayload(const QString& path)
         m_payload.reset();
         return;
     }
+    m_payload->setVerifyHashes(m_payloadVerify);
 
     m_payloadLoaded = true;
     m_partitions.clear();
@@ -245,14 +247,10 @@ void FastbootController::flashAll()
 
             bool success = false;
             if(isPayload && m_payload) {
-                // Extract partition from payload and flash
-                QString tmpPath = QDir::temp().filePath("sakura_fb_" + name + ".img");
-                if(m_payload->extractPartition(name, tmpPath, [this,i,checked](qint64 c, qint64 t){
+                // Decompress straight into sparse segments, no temp file
+                success = m_service->flashPayloadPartition(name, *m_payload, name, [this](qint64 c, qint64 t){
                     QMetaObject::invokeMethod(this,[this,c,t](){ updateProgress(c,t,""); },Qt::QueuedConnection);
-                })) {
-                    success = m_service->flashPartition(name, tmpPath);
-                    QFile::remove(tmpPath);
-                }
+                });
             } else if(!file.isEmpty()) {
                 success = m_service->flashPartition(name, file);
             }
@@ -561,7 +559,8 @@ void FastbootController::extractPayloadPartition(const QString& name, const QStr
     setBusy(true);
     addLog(L("正在提取 ","Extracting ") + name + " → " + savePath);
     (void)QtConcurrent::run([this,name,savePath](){
-        bool ok = m_payload->extractPartition(name, savePath, [this](qint64 c, qint64 t){
+        PayloadExtractor extractor(*m_payload);
+        bool ok = extractor.extract({{name, savePath}}, [this](qint64 c, qint64 t){
             QMetaObject::invokeMethod(this,[this,c,t](){ updateProgress(c,t,""); },Qt::QueuedConnection);
         });
         QMetaObject::invokeMethod(this,[this,name,ok](){
@@ -572,6 +571,48 @@ void FastbootController::extractPayloadPartition(const QString& name, const QStr
     });
 }
 
+void FastbootController::extractPayloadPartitions(const QStringList& names, const QString& outDir)
+{
+    if(!m_payloadLoaded || !m_payload) { addLogErr(L("未加载 payload","No payload loaded")); return; }
+    if(names.isEmpty()) return;
+    setBusy(true);
+    addLog(L("正在提取 ","Extracting ") + QString::number(names.size()) + L(" 个分区 → "," partitions → ") + outDir);
+    (void)QtConcurrent::run([this,names,outDir](){
+        QList<PayloadExtractJob> jobs;
+        for(const auto& n : names) jobs.append({n, QDir(outDir).filePath(n + ".img")});
+        PayloadExtractor extractor(*m_payload);
+        bool ok = extractor.extract(jobs, [this](qint64 c, qint64 t){
+            QMetaObject::invokeMethod(this,[this,c,t](){ updateProgress(c,t,""); },Qt::QueuedConnection);
+        });
+        QMetaObject::invokeMethod(this,[this,names,ok](){
+            if(ok) addLogOk(QString::number(names.size()) + L(" 个分区提取完成"," partitions extracted"));
+            else   addLogFail(L("提取失败","Extract failed"));
+            resetProgress(); setBusy(false);
+        });
+    });
+}
+
+void FastbootController::setPayloadVerify(bool on)
+{
+    if(m_payloadVerify == on) return;
+    m_payloadVerify = on;
+    if(m_payload) m_payload->setVerifyHashes(on);
+    emit payloadChanged();
+}
+
+void FastbootController::setPayloadSourceDir(const QString& dir)
+{
+    if(!m_payloadLoaded || !m_payload) { addLogErr(L("未加载 payload","No payload loaded")); return; }
+    int found = 0, missing = 0;
+    for(const auto& part : m_payload->partitions()) {
+        if(!PayloadParser::needsSource(part)) continue;
+        QString img = QDir(dir).filePath(part.name + ".img");
+        if(QFile::exists(img) && m_payload->setSourceFile(part.name, img)) ++found;
+        else { ++missing; addLogErr(L("缺少源镜像: ","Missing source image: ") + img); }
+    }
+    if(missing == 0) addLogOk(L("源镜像已设置: ","Source images set: ") + QString::number(found));
+}
+
 // ═══ SCRIPT ═══
 void FastbootController::loadBatScript(const QString& path)
 {
@@ -34,6 +34,7 @@ class FastbootController : public QObject {
     Q_PROPERTY(bool hasCheckedPartitions READ hasCheckedPartitions NOTIFY partitionsChanged)
     Q_PROPERTY(bool payloadLoaded READ payloadLoaded NOTIFY payloadChanged)
     Q_PROPERTY(QString payloadPath READ payloadPath NOTIFY payloadChanged)
+    Q_PROPERTY(bool payloadVerify READ payloadVerify WRITE setPayloadVerify NOTIFY payloadChanged)
 
     // Progress
     Q_PROPERTY(double progress READ progress NOTIFY progressChanged)
@@ -114,6 +115,12 @@ public:
 
     // Payload
     Q_INVOKABLE void extractPayloadPartition(const QString& name, const QString& savePath);
+    Q_INVOKABLE void extractPayloadPartitions(const QStringList& names, const QString& outDir);
+    // Incremental OTA: <dir>/<partition>.img are the images the payload was built against
+    Q_INVOKABLE void setPayloadSourceDir(const QString& dir);
+    // SHA-256 check of operation data and whole partitions while extracting/flashing
+    Q_INVOKABLE void setPayloadVerify(bool on);
+    bool payloadVerify() const { return m_payloadVerify; }
 
     // Script
     Q_INVOKABLE void loadBatScript(const QString& path);
@@ -166,6 +173,7 @@ private:
     int m_checkedCount = 0;
 
     bool m_payloadLoaded = false;
+    bool m_payloadVerify = false;
     QString m_payloadPath;
     QStringList m_batScript;
 
@@ -12,6 +12,7 @@
 #include <QDir>
 #include <QFileInfo>
 #include <QFile>
+#include <QStandardPaths>
 
 #ifdef _WIN32
 #include "transport/win32_serial_transport.h"
@@ -544,42 +545,41 @@ void MediatekController::erasePartitions()
     });
 }
 
-void MediatekController::readFlash()
+void MediatekController::readFlash(const QString& outDir)
 {
     if(!isDeviceReady()) { addLogErr(L("需要设备连接后才可操作","Device must be connected")); return; }
     if(!hasCheckedPartitions()) { addLogFail(L("未选择分区","No partitions selected")); return; }
+    QString dir = outDir;
+    if(dir.isEmpty())
+        dir = QDir(QStandardPaths::writableLocation(QStandardPaths::DocumentsLocation))
+                  .filePath("mtk_backup_" + QDateTime::currentDateTime().toString("yyyyMMdd_HHmmss"));
     setBusy(true);
-    QVariantList checked;
-    for(const auto& v : m_partitions) if(v.toMap()["checked"].toBool()) checked.append(v);
-    addLog(L("正在读取 ","Reading ") + QString::number(checked.size()) + L(" 个分区...","partitions..."));
+    QStringList names;
+    for(const auto& v : m_partitions) if(v.toMap()["checked"].toBool()) names.append(v.toMap()["name"].toString());
+    addLog(L("正在读取 ","Reading ") + QString::number(names.size()) + L(" 个分区 → "," partitions → ") + dir);
 
-    (void)QtConcurrent::run([this,checked](){
+    (void)QtConcurrent::run([this,names,dir](){
         int ok=0, fail=0;
-        for(int i=0;i<checked.size();i++){
-            QString name=checked[i].toMap()["name"].toString();
-            QMetaObject::invokeMethod(this,[this,name,i,checked](){
-                addLog(QString("  [%1/%2] ").arg(i+1).arg(checked.size()) + L("读取 ","Reading ") + name + "...");
-                updateProgress(i, checked.size(), name);
-            },Qt::QueuedConnection);
-
-            QByteArray data = m_service->readPartition(name);
-            bool success = !data.isEmpty();
-
-            QMetaObject::invokeMethod(this,[this,name,i,checked,success](){
-                if(success)
-                    addLogOk(QString("  [%1/%2] ").arg(i+1).arg(checked.size()) + name + " → OKAY");
-                else
-                    addLogFail(QString("  [%1/%2] ").arg(i+1).arg(checked.size()) + name + " → FAIL");
-                updateProgress(i+1, checked.size(), name);
+        bool done = m_service->backupPartitions(names, dir, [this,&ok,&fail,names](int i, const MtkBackupEntry& e){
+            if(e.ok) ok++; else fail++;
+            QMetaObject::invokeMethod(this,[this,e,i,names](){
+                QString tag = QString("  [%1/%2] ").arg(i+1).arg(names.size());
+                if(e.ok) {
+                    double mbps = e.bytes/1048576.0/qMax<qint64>(e.elapsedMs,1)*1000.0;
+                    addLogOk(tag + e.name + " → " + fmtSz(e.bytes) + QString(", %1 s, %2 MB/s")
+                                 .arg(e.elapsedMs/1000.0,0,'f',1).arg(mbps,0,'f',1));
+                } else {
+                    addLogFail(tag + e.name + " → FAIL");
+                }
             },Qt::QueuedConnection);
-            if(success) ok++; else fail++;
-        }
-        QMetaObject::invokeMethod(this,[this,checked,ok,fail](){
-            if(fail==0)
-                addLogOk(L("读取完成: ","Read complete: ") + QString::number(ok) + L(" 个分区"," partitions"));
+        });
+        QMetaObject::invokeMethod(this,[this,dir,ok,fail,done](){
+            if(done)
+                addLogOk(L("读取完成: ","Read complete: ") + QString::number(ok) + L(" 个分区已保存到 "," partitions saved to ") + dir);
             else
                 addLogErr(L("读取完成: ","Read complete: ") + QString::number(ok) + " OK, " + QString::number(fail) + L(" 失败"," failed"));
             resetProgress(); setBusy(false);
+            emit operationCompleted(done, L("读取完成","Read complete"));
         });
     });
 }
@@ -607,7 +607,7 @@ void MediatekController::writeFlash()
             if(!filePath.isEmpty()) {
                 QFile f(filePath);
                 if(f.open(QIODevice::ReadOnly)) {
-                    success = m_service->writePartition(name, f.readAll());
+                    success = m_service->writePartition(name, &f);
                     f.close();
                 }
             }
@@ -100,7 +100,9 @@ public:
     // Operations (need device ready)
     Q_INVOKABLE void readPartitionTable();
     Q_INVOKABLE void erasePartitions();
-    Q_INVOKABLE void readFlash();
+    // Backs up the checked partitions to <outDir>/<name>.bin plus a scatter
+    // file; defaults to a timestamped mtk_backup_<time> folder in Documents
+    Q_INVOKABLE void readFlash(const QString& outDir = QString());
     Q_INVOKABLE void writeFlash();
     Q_INVOKABLE void formatAll();
     Q_INVOKABLE void readImei();
@@ -56,7 +56,7 @@ Item {
             FileSelector {
                 Layout.preferredWidth: 400
                 label: "Payload:"
-                filter: "Payload (payload.bin);;All Files (*)"
+                filter: "Payload (payload.bin *.zip);;All Files (*)"
                 onFileSelected: function(path) { fastbootController.loadPayload(path); }
             }
         }
@@ -591,6 +591,7 @@ void QualcommController::readPartitions()
         qint64 total = 0;
         for(const auto& v : checked) total += v.toMap()["sectors"].toString().toLongLong() * 512;
         qint64 done = 0;
+        int fail = 0;
 
         for(int i=0; i<checked.size(); i++){
             auto p = checked[i].toMap();
@@ -602,33 +603,40 @@ void QualcommController::readPartitions()
             }, Qt::QueuedConnection);
 
             uint32_t lun = p["lun"].toString().toUInt();
-            QByteArray data = m_service->readPartition(name, lun,
-                [this,&done,total,name](qint64 c, qint64 t) {
-                    done += (c - (done % t));
-                    QMetaObject::invokeMethod(this,[this,done,total,name](){
-                        updateProgress(done, total, name);
-                    }, Qt::QueuedConnection);
-                });
 
-            // Save to file
-            if(!data.isEmpty()) {
-                QString savePath = m_firmwareDir + "/" + name + ".bin";
-                QFile out(savePath);
-                if(out.open(QIODevice::WriteOnly)) { out.write(data); out.close(); }
+            // Stream straight to file
+            QString savePath = m_firmwareDir + "/" + name + ".bin";
+            QFile out(savePath);
+            bool readOk = false;
+            if(out.open(QIODevice::WriteOnly)) {
+                readOk = m_service->readPartition(name, &out, lun,
+                    [this,&done,total,name](qint64 c, qint64 t) {
+                        done += (c - (done % t));
+                        QMetaObject::invokeMethod(this,[this,done,total,name](){
+                            updateProgress(done, total, name);
+                        }, Qt::QueuedConnection);
+                    });
+                out.close();
+                if(!readOk) out.remove();
             }
             done += sz; // Ensure progress advances
+            if(!readOk) fail++;
 
             // Per-partition result
-            QMetaObject::invokeMethod(this,[this,name,i,checked](){
-                addLogOk(QString("  [%1/%2] ").arg(i+1).arg(checked.size()) + name + " → OKAY");
+            QMetaObject::invokeMethod(this,[this,name,i,checked,readOk](){
+                if(readOk) addLogOk(QString("  [%1/%2] ").arg(i+1).arg(checked.size()) + name + " → OKAY");
+                else addLogErr(QString("  [%1/%2] ").arg(i+1).arg(checked.size()) + name + " → FAIL");
             }, Qt::QueuedConnection);
         }
 
-        QMetaObject::invokeMethod(this,[this,checked](){
-            addLogOk(L("读取完成: ", "Read complete: ") + QString::number(checked.size()) + L(" 个分区已保存", " partitions saved"));
+        QMetaObject::invokeMethod(this,[this,checked,fail](){
+            if(fail == 0)
+                addLogOk(L("读取完成: ", "Read complete: ") + QString::number(checked.size()) + L(" 个分区已保存", " partitions saved"));
+            else
+                addLogErr(L("读取完成: ", "Read complete: ") + QString::number(checked.size() - fail) + " OK, " + QString::number(fail) + L(" 失败", " failed"));
             if(m_generateXml) addLogOk(L("已生成 rawprogram.xml + patch.xml", "Generated rawprogram.xml + patch.xml"));
             resetProgress(); setBusy(false);
-            emit operationCompleted(true, L("读取完成", "Read complete"));
+            emit operationCompleted(fail == 0, L("读取完成", "Read complete"));
         });
     });
 }
@@ -662,10 +670,27 @@ void QualcommController::writePartitions()
     setBusy(true);
     addLog(L("正在写入 ", "Writing ") + QString::number(checked.size()) + L(" 个分区 (metaSuper=%1)...", " partitions (metaSuper=%1)...").arg(m_metaSuper));
 
-    (void)QtConcurrent::run([this, checked](){
+    QList<PatchEntry> patches;
+    for(const auto& v : m_patchEntries) {
+        auto pe = v.toMap();
+        PatchEntry pa;
+        pa.filename = pe["file"].toString();
+        pa.sectorOffset = pe["offset"].toString().toULongLong();
+        pa.sectorOffsetExpr = pe["offsetExpr"].toString();
+        pa.byteOffset = pe["byteOff"].toString().toUInt();
+        pa.sizeInBytes = pe["size"].toString().toUInt();
+        pa.value = pe["value"].toString();
+        pa.physicalPartition = pe["lun"].toString().toUInt();
+        patches.append(pa);
+    }
+
+    (void)QtConcurrent::run([this, checked, patches](){
         qint64 total = 0;
         for(const auto& v : checked) total += v.toMap()["sectors"].toString().toLongLong() * 512;
         qint64 done = 0;
+        QSet<uint32_t> writtenLuns;
+        int fail = 0;
+        bool patchOk = true;
 
         for(int i=0; i<checked.size(); i++){
             auto p = checked[i].toMap();
@@ -678,6 +703,7 @@ void QualcommController::writePartitions()
                 QMetaObject::invokeMethod(this,[this,name,file,i,checked](){
                     addLogErr(QString("  [%1/%2] ").arg(i+1).arg(checked.size()) + name + " ← " + file + " → ERROR (" + L("文件未找到","file not found") + ")");
                 }, Qt::QueuedConnection);
+                fail++;
                 done += sz;
                 QMetaObject::invokeMethod(this,[this,done,total](){
                     updateProgress(done, total, "skip");
@@ -692,31 +718,65 @@ void QualcommController::writePartitions()
             // Write partition via Firehose
             uint32_t lun = p["lun"].toString().toUInt();
             QString fullPath = m_firmwareDir + "/" + file;
-            QFile imgFile(fullPath);
+            auto progress = [this,name](qint64 c, qint64 t) {
+                QMetaObject::invokeMethod(this,[this,c,t,name](){
+                    updateProgress(c, t, name);
+                }, Qt::QueuedConnection);
+            };
             bool writeOk = false;
-            if(imgFile.open(QIODevice::ReadOnly)) {
-                QByteArray data = imgFile.readAll();
-                imgFile.close();
-                writeOk = m_service->writePartition(name, data, lun,
-                    [this,&done,total,name](qint64 c, qint64 t) {
-                        QMetaObject::invokeMethod(this,[this,c,t,name](){
-                            updateProgress(c, t, name);
-                        }, Qt::QueuedConnection);
-                    });
+            if(p.contains("startExpr")) {
+                // rawprogram entry: stream straight to its start sector
+                RawprogramEntry e;
+                e.label = name; e.filename = file;
+                e.startSectorExpr = p["startExpr"].toString();
+                e.startSector = e.startSectorExpr.toULongLong();
+                e.numSectors = p["sectors"].toString().toULongLong();
+                e.sectorSize = p["sectorSize"].toUInt();
+                e.physicalPartition = lun;
+                e.sparse = p["sparse"].toBool();
+                writeOk = m_service->programEntry(e, fullPath, progress);
+                if(writeOk) writtenLuns.insert(lun);
+            } else {
+                QFile imgFile(fullPath);
+                if(imgFile.open(QIODevice::ReadOnly)) {
+                    writeOk = m_service->writePartition(name, &imgFile, lun, progress);
+                    imgFile.close();
+                }
             }
+            if(!writeOk) fail++;
             done += sz;
 
             // Per-partition result
-            QMetaObject::invokeMethod(this,[this,name,i,checked](){
-                addLogOk(QString("  [%1/%2] ").arg(i+1).arg(checked.size()) + name + " → OKAY");
+            QMetaObject::invokeMethod(this,[this,name,i,checked,writeOk](){
+                if(writeOk) addLogOk(QString("  [%1/%2] ").arg(i+1).arg(checked.size()) + name + " → OKAY");
+                else addLogErr(QString("  [%1/%2] ").arg(i+1).arg(checked.size()) + name + " → FAIL");
             }, Qt::QueuedConnection);
         }
 
-        QMetaObject::invokeMethod(this,[this,checked](){
-            addLogOk(L("写入完成: ", "Write complete: ") + QString::number(checked.size()) + L(" 个分区", " partitions"));
+        // Factory-style flash: patch GPT headers/CRCs only on the LUNs that were
+        // written, and only if the whole batch went through
+        QList<PatchEntry> lunPatches;
+        for(const auto& pa : patches)
+            if(writtenLuns.contains(pa.physicalPartition)) lunPatches.append(pa);
+        if(fail > 0 && !lunPatches.isEmpty()) {
+            QMetaObject::invokeMethod(this,[this](){
+                addLogFail(L("存在写入失败, 已跳过补丁", "Skipping patches because some writes failed"));
+            }, Qt::QueuedConnection);
+        } else if(!lunPatches.isEmpty()) {
+            patchOk = m_service->applyPatches(lunPatches);
+            int applied = lunPatches.size();
+            QMetaObject::invokeMethod(this,[this,patchOk,applied](){
+                if(patchOk) addLogOk(L("补丁已应用: ", "Patches applied: ") + QString::number(applied));
+                else addLogErr(L("部分补丁应用失败", "Some patches failed to apply"));
+            }, Qt::QueuedConnection);
+        }
+
+        QMetaObject::invokeMethod(this,[this,checked,fail,patchOk](){
+            if(fail == 0) addLogOk(L("写入完成: ", "Write complete: ") + QString::number(checked.size()) + L(" 个分区", " partitions"));
+            else addLogErr(L("写入完成: ", "Write complete: ") + QString::number(checked.size() - fail) + " OK, " + QString::number(fail) + L(" 失败", " failed"));
             if(m_autoReboot) addLog(L("正在自动重启设备...", "Auto-rebooting device..."));
             resetProgress(); setBusy(false);
-            emit operationCompleted(true, L("写入完成", "Write complete"));
+            emit operationCompleted(fail == 0 && patchOk, L("写入完成", "Write complete"));
         });
     });
 }
@@ -936,6 +996,7 @@ void QualcommController::loadMultipleFiles(const QStringList& paths)
             QVariantMap p;
             p["name"]=e.label; p["file"]=e.filename;
             p["start"]=QString("0x%1").arg(e.startSector,0,16).toUpper();
+            p["startExpr"]=e.startSectorExpr; p["sectorSize"]=e.sectorSize;
             p["sectors"]=QString::number(e.numSectors);
             p["size"]=fmtSize(uint64_t(e.numSectors)*e.sectorSize);
             p["lun"]=QString::number(e.physicalPartition);
@@ -973,6 +1034,7 @@ void QualcommController::loadMultipleFiles(const QStringList& paths)
         for(const auto& pa : patches) {
             QVariantMap pe;
             pe["file"]=pa.filename; pe["offset"]=QString::number(pa.sectorOffset);
+            pe["offsetExpr"]=pa.sectorOffsetExpr;
             pe["byteOff"]=QString::number(pa.byteOffset); pe["size"]=QString::number(pa.sizeInBytes);
             pe["value"]=pa.value; pe["lun"]=QString::number(pa.physicalPartition); pe["sourceXml"]=pf;
             m_patchEntries.append(pe); patchTotal++;
@@ -0,0 +1,62 @@
+#include "brotli_decoder.h"
+#include "core/logger.h"
+
+#ifdef SAKURA_HAVE_BROTLI
+#include <brotli/decode.h>
+#endif
+
+namespace sakura {
+
+static constexpr char LOG_TAG[] = "Brotli";
+
+bool BrotliDecoder::isAvailable()
+{
+#ifdef SAKURA_HAVE_BROTLI
+    return true;
+#else
+    return false;
+#endif
+}
+
+QByteArray BrotliDecoder::decompress(const QByteArray& data, qint64 expectedSize)
+{
+#ifdef SAKURA_HAVE_BROTLI
+    BrotliDecoderState* state = BrotliDecoderCreateInstance(nullptr, nullptr, nullptr);
+    if (!state) {
+        LOG_ERROR_CAT(LOG_TAG, "BrotliDecoderCreateInstance failed");
+        return {};
+    }
+
+    QByteArray output;
+    output.resize(expectedSize > 0 ? expectedSize : qMax<qint64>(data.size() * 4, 65536));
+
+    size_t availIn = static_cast<size_t>(data.size());
+    const uint8_t* nextIn = reinterpret_cast<const uint8_t*>(data.constData());
+    size_t produced = 0;
+    BrotliDecoderResult ret;
+    do {
+        if (produced == static_cast<size_t>(output.size()))
+            output.resize(output.size() * 2);
+        size_t availOut = static_cast<size_t>(output.size()) - produced;
+        uint8_t* nextOut = reinterpret_cast<uint8_t*>(output.data()) + produced;
+        ret = BrotliDecoderDecompressStream(state, &availIn, &nextIn, &availOut, &nextOut, nullptr);
+        produced = static_cast<size_t>(output.size()) - availOut;
+    } while (ret == BROTLI_DECODER_RESULT_NEEDS_MORE_OUTPUT);
+
+    BrotliDecoderDestroyInstance(state);
+
+    if (ret != BROTLI_DECODER_RESULT_SUCCESS) {
+        LOG_ERROR_CAT(LOG_TAG, QString("Brotli decompression failed: %1").arg(ret));
+        return {};
+    }
+    output.resize(static_cast<qint64>(produced));
+    return output;
+#else
+    Q_UNUSED(expectedSize);
+    LOG_ERROR_CAT(LOG_TAG, QString("Brotli data (%1 bytes) cannot be decoded: built without libbrotlidec")
+                               .arg(data.size()));
+    return {};
+#endif
+}
+
+} // namespace sakura
@@ -0,0 +1,18 @@
+#pragma once
+
+#include <QByteArray>
+
+namespace sakura {
+
+// Brotli decoder using libbrotlidec (payload.bin BROTLI_BSDIFF patches).
+// Built only when the library is found; otherwise decompress() fails with
+// a log message.
+class BrotliDecoder {
+public:
+    static bool isAvailable();
+
+    // `expectedSize` pre-sizes the output when the caller knows it
+    static QByteArray decompress(const QByteArray& data, qint64 expectedSize = -1);
+};
+
+} // namespace sakura
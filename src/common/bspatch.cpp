@@ -0,0 +1,119 @@
+#include "bspatch.h"
+#include "brotli_decoder.h"
+#include "bzip2_decoder.h"
+#include "core/logger.h"
+
+#include <cstring>
+
+namespace sakura {
+
+static constexpr char LOG_TAG[] = "BsPatch";
+static constexpr qint64 HEADER_SIZE = 32;
+
+// bsdiff integers are 64-bit sign-magnitude, little-endian
+static qint64 offtin(const uchar* buf)
+{
+    qint64 y = buf[7] & 0x7F;
+    for (int i = 6; i >= 0; --i)
+        y = y * 256 + buf[i];
+    return (buf[7] & 0x80) ? -y : y;
+}
+
+static bool decodeStream(uint8_t type, const QByteArray& data, qint64 expectedSize, QByteArray& out)
+{
+    switch (type) {
+    case 0:
+        out = data;
+        return true;
+    case 1:
+        out = Bzip2Decoder::decompress(data, expectedSize);
+        return !out.isEmpty() || data.isEmpty();
+    case 2:
+        out = BrotliDecoder::decompress(data, expectedSize);
+        return !out.isEmpty() || data.isEmpty();
+    default:
+        LOG_ERROR_CAT(LOG_TAG, QString("Unknown BSDF2 stream compression %1").arg(type));
+        return false;
+    }
+}
+
+bool BsPatch::apply(const QByteArray& oldData, const QByteArray& patch, QByteArray& newData)
+{
+    if (patch.size() < HEADER_SIZE) {
+        LOG_ERROR_CAT(LOG_TAG, "Patch too short");
+        return false;
+    }
+    const auto* hdr = reinterpret_cast<const uchar*>(patch.constData());
+
+    uint8_t types[3];
+    if (std::memcmp(hdr, "BSDIFF40", 8) == 0) {
+        types[0] = types[1] = types[2] = 1;
+    } else if (std::memcmp(hdr, "BSDF2", 5) == 0) {
+        types[0] = hdr[5];
+        types[1] = hdr[6];
+        types[2] = hdr[7];
+    } else {
+        LOG_ERROR_CAT(LOG_TAG, "Unknown patch magic");
+        return false;
+    }
+
+    const qint64 ctrlLen = offtin(hdr + 8);
+    const qint64 diffLen = offtin(hdr + 16);
+    const qint64 newSize = offtin(hdr + 24);
+    if (ctrlLen < 0 || diffLen < 0 || newSize < 0
+        || HEADER_SIZE + ctrlLen + diffLen > patch.size()) {
+        LOG_ERROR_CAT(LOG_TAG, "Corrupt patch header");
+        return false;
+    }
+
+    QByteArray ctrl, diff, extra;
+    if (!decodeStream(types[0], patch.mid(HEADER_SIZE, ctrlLen), -1, ctrl)
+        || !decodeStream(types[1], patch.mid(HEADER_SIZE + ctrlLen, diffLen), newSize, diff)
+        || !decodeStream(types[2], patch.mid(HEADER_SIZE + ctrlLen + diffLen), -1, extra)) {
+        LOG_ERROR_CAT(LOG_TAG, "Failed to decode patch streams");
+        return false;
+    }
+
+    newData.resize(newSize);
+    char* out = newData.data();
+    const char* oldPtr = oldData.constData();
+    const qint64 oldSize = oldData.size();
+
+    qint64 oldPos = 0, newPos = 0, ctrlPos = 0, diffPos = 0, extraPos = 0;
+    while (newPos < newSize) {
+        if (ctrlPos + 24 > ctrl.size()) {
+            LOG_ERROR_CAT(LOG_TAG, "Control stream ended early");
+            return false;
+        }
+        const auto* c = reinterpret_cast<const uchar*>(ctrl.constData() + ctrlPos);
+        const qint64 x = offtin(c), y = offtin(c + 8), z = offtin(c + 16);
+        ctrlPos += 24;
+
+        if (x < 0 || y < 0 || newPos + x > newSize || diffPos + x > diff.size()) {
+            LOG_ERROR_CAT(LOG_TAG, "Corrupt diff block");
+            return false;
+        }
+
+        // Diff bytes are added to the old bytes they overlap
+        std::memcpy(out + newPos, diff.constData() + diffPos, static_cast<size_t>(x));
+        const qint64 from = qMax<qint64>(0, oldPos);
+        const qint64 to   = qMin(oldSize, oldPos + x);
+        for (qint64 i = from; i < to; ++i)
+            out[newPos + (i - oldPos)] = static_cast<char>(out[newPos + (i - oldPos)] + oldPtr[i]);
+        newPos  += x;
+        oldPos  += x;
+        diffPos += x;
+
+        if (newPos + y > newSize || extraPos + y > extra.size()) {
+            LOG_ERROR_CAT(LOG_TAG, "Corrupt extra block");
+            return false;
+        }
+        std::memcpy(out + newPos, extra.constData() + extraPos, static_cast<size_t>(y));
+        newPos   += y;
+        extraPos += y;
+        oldPos   += z;
+    }
+    return true;
+}
+
+} // namespace sakura
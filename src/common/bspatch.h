@@ -0,0 +1,15 @@
+#pragma once
+
+#include <QByteArray>
+
+namespace sakura {
+
+// Applies bsdiff patches in the two container formats update_engine uses:
+// classic "BSDIFF40" (three bzip2 streams) and "BSDF2" (each stream raw,
+// bzip2 or Brotli, as recorded in the header).
+class BsPatch {
+public:
+    static bool apply(const QByteArray& oldData, const QByteArray& patch, QByteArray& newData);
+};
+
+} // namespace sakura
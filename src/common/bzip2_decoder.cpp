@@ -0,0 +1,82 @@
+#include "bzip2_decoder.h"
+#include "core/logger.h"
+
+#ifdef SAKURA_HAVE_BZIP2
+#include <bzlib.h>
+#include <climits>
+#endif
+
+namespace sakura {
+
+static constexpr char LOG_TAG[] = "BZ2";
+
+bool Bzip2Decoder::isAvailable()
+{
+#ifdef SAKURA_HAVE_BZIP2
+    return true;
+#else
+    return false;
+#endif
+}
+
+QByteArray Bzip2Decoder::decompress(const QByteArray& data, qint64 expectedSize)
+{
+#ifdef SAKURA_HAVE_BZIP2
+    bz_stream strm{};
+    if (BZ2_bzDecompressInit(&strm, 0, 0) != BZ_OK) {
+        LOG_ERROR_CAT(LOG_TAG, "BZ2_bzDecompressInit failed");
+        return {};
+    }
+
+    QByteArray output;
+    output.resize(expectedSize > 0 ? expectedSize : qMax<qint64>(data.size() * 4, 65536));
+
+    // Concatenated streams are allowed, as produced by parallel bzip2
+    const char* in = data.constData();
+    qint64 inLeft = data.size();
+    qint64 produced = 0;
+    int ret = BZ_OK;
+    for (;;) {
+        const unsigned int inChunk = static_cast<unsigned int>(qMin<qint64>(inLeft, UINT_MAX));
+        strm.next_in  = const_cast<char*>(in);
+        strm.avail_in = inChunk;
+        if (produced == output.size())
+            output.resize(output.size() * 2);
+        strm.next_out  = output.data() + produced;
+        strm.avail_out = static_cast<unsigned int>(qMin<qint64>(output.size() - produced, UINT_MAX));
+
+        const unsigned int outBefore = strm.avail_out;
+        ret = BZ2_bzDecompress(&strm);
+        produced += outBefore - strm.avail_out;
+        in += inChunk - strm.avail_in;
+        inLeft -= inChunk - strm.avail_in;
+
+        if (ret == BZ_STREAM_END) {
+            if (inLeft == 0)
+                break;
+            BZ2_bzDecompressEnd(&strm);
+            strm = bz_stream{};
+            if (BZ2_bzDecompressInit(&strm, 0, 0) != BZ_OK)
+                return {};
+            continue;
+        }
+        if (ret != BZ_OK || (inLeft == 0 && outBefore == strm.avail_out))
+            break;
+    }
+    BZ2_bzDecompressEnd(&strm);
+
+    if (ret != BZ_STREAM_END) {
+        LOG_ERROR_CAT(LOG_TAG, QString("bzip2 decompression failed: %1").arg(ret));
+        return {};
+    }
+    output.resize(produced);
+    return output;
+#else
+    Q_UNUSED(expectedSize);
+    LOG_ERROR_CAT(LOG_TAG, QString("bzip2 data (%1 bytes) cannot be decoded: built without libbz2")
+                               .arg(data.size()));
+    return {};
+#endif
+}
+
+} // namespace sakura
@@ -0,0 +1,18 @@
+#pragma once
+
+#include <QByteArray>
+
+namespace sakura {
+
+// bzip2 decoder using libbz2 (payload.bin REPLACE_BZ and bsdiff streams).
+// Built only when libbz2 is found; otherwise isAvailable() is false and
+// decompress() fails with a log message.
+class Bzip2Decoder {
+public:
+    static bool isAvailable();
+
+    // `expectedSize` pre-sizes the output when the caller knows it
+    static QByteArray decompress(const QByteArray& data, qint64 expectedSize = -1);
+};
+
+} // namespace sakura
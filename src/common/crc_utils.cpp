@@ -1,4 +1,5 @@
 #include "crc_utils.h"
+#include <QtEndian>
 
 namespace sakura {
 
@@ -134,9 +135,21 @@ uint16_t Crc16::sprdChecksum(const QByteArray& data)
 
 uint16_t MtkChecksum::compute(const uint8_t* data, size_t length)
 {
-    // MTK BROM uses 16-bit word-wise XOR (little-endian)
-    uint16_t checksum = 0;
+    return update(0, data, length);
+}
+
+uint16_t MtkChecksum::update(uint16_t checksum, const uint8_t* data, size_t length)
+{
+    // MTK BROM uses 16-bit word-wise XOR (little-endian). Four words are
+    // XORed at a time as one 64-bit lane and folded at the end.
+    uint64_t wide = 0;
     size_t i = 0;
+    for (; i + 8 <= length; i += 8)
+        wide ^= qFromLittleEndian<quint64>(data + i);
+    wide ^= wide >> 32;
+    wide ^= wide >> 16;
+    checksum ^= static_cast<uint16_t>(wide);
+
     for (; i + 1 < length; i += 2) {
         uint16_t word = static_cast<uint16_t>(data[i]) |
                         (static_cast<uint16_t>(data[i + 1]) << 8);
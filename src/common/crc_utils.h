@@ -37,6 +37,10 @@ class MtkChecksum {
 public:
     static uint16_t compute(const uint8_t* data, size_t length);
     static uint16_t compute(const QByteArray& data);
+
+    // Incremental form: feed consecutive pieces of one buffer. Every piece
+    // but the last must have even length to keep the 16-bit word alignment.
+    static uint16_t update(uint16_t checksum, const uint8_t* data, size_t length);
 };
 
 } // namespace sakura
@@ -0,0 +1,74 @@
+#include "file_io.h"
+
+#ifdef _WIN32
+#include <io.h>
+#include <windows.h>
+#else
+#include <cerrno>
+#include <unistd.h>
+#endif
+
+namespace sakura {
+
+#ifdef _WIN32
+// A synchronous handle still honours the offset in OVERLAPPED
+static OVERLAPPED overlappedAt(qint64 offset)
+{
+    OVERLAPPED ov{};
+    ov.Offset     = static_cast<DWORD>(offset & 0xFFFFFFFF);
+    ov.OffsetHigh = static_cast<DWORD>(static_cast<quint64>(offset) >> 32);
+    return ov;
+}
+#endif
+
+qint64 FileIo::readAt(QFile& file, qint64 offset, char* dst, qint64 size)
+{
+    const int fd = file.handle();
+    if (fd < 0) return -1;
+
+    qint64 done = 0;
+    while (done < size) {
+        const qint64 want = qMin<qint64>(size - done, 1 << 30);
+#ifdef _WIN32
+        HANDLE h = reinterpret_cast<HANDLE>(_get_osfhandle(fd));
+        OVERLAPPED ov = overlappedAt(offset + done);
+        DWORD got = 0;
+        if (!ReadFile(h, dst + done, static_cast<DWORD>(want), &got, &ov) || got == 0)
+            break;
+#else
+        ssize_t got = ::pread(fd, dst + done, static_cast<size_t>(want),
+                              static_cast<off_t>(offset + done));
+        if (got < 0 && errno == EINTR) continue;
+        if (got <= 0) break;
+#endif
+        done += got;
+    }
+    return (done > 0 || size == 0) ? done : -1;
+}
+
+qint64 FileIo::writeAt(QFile& file, qint64 offset, const char* src, qint64 size)
+{
+    const int fd = file.handle();
+    if (fd < 0) return -1;
+
+    qint64 done = 0;
+    while (done < size) {
+        const qint64 want = qMin<qint64>(size - done, 1 << 30);
+#ifdef _WIN32
+        HANDLE h = reinterpret_cast<HANDLE>(_get_osfhandle(fd));
+        OVERLAPPED ov = overlappedAt(offset + done);
+        DWORD put = 0;
+        if (!WriteFile(h, src + done, static_cast<DWORD>(want), &put, &ov) || put == 0)
+            break;
+#else
+        ssize_t put = ::pwrite(fd, src + done, static_cast<size_t>(want),
+                               static_cast<off_t>(offset + done));
+        if (put < 0 && errno == EINTR) continue;
+        if (put <= 0) break;
+#endif
+        done += put;
+    }
+    return (done > 0 || size == 0) ? done : -1;
+}
+
+} // namespace sakura
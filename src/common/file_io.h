@@ -0,0 +1,22 @@
+#pragma once
+
+#include <QFile>
+#include <cstdint>
+
+namespace sakura {
+
+// Positioned file I/O (pread/pwrite). The file offset is not used, so
+// several threads can read or write one open file at independent offsets.
+// On POSIX it is also left unchanged; on Windows ReadFile/WriteFile with an
+// OVERLAPPED offset move the file pointer, so do not mix these calls with
+// QFile::read()/write() or pos() on the same file. The QFile must be
+// unbuffered for writes (QIODevice::Unbuffered) so no data sits in Qt's
+// own write buffer.
+class FileIo {
+public:
+    // Both return the number of bytes transferred, or -1 if none could be
+    static qint64 readAt(QFile& file, qint64 offset, char* dst, qint64 size);
+    static qint64 writeAt(QFile& file, qint64 offset, const char* src, qint64 size);
+};
+
+} // namespace sakura
@@ -1,5 +1,6 @@
 #include "sparse_stream.h"
 #include "core/logger.h"
+#include <algorithm>
 #include <cstring>
 
 namespace sakura {
@@ -110,29 +111,55 @@ QByteArray SparseStream::toRaw(const QByteArray& sparseData)
 bool SparseStream::convertToRaw(const QString& sparsePath, const QString& rawPath,
                                   std::function<void(qint64, qint64)> progress)
 {
-    QFile sparseFile(sparsePath);
-    if (!sparseFile.open(QIODevice::ReadOnly)) return false;
-
-    QByteArray sparseData = sparseFile.readAll();
-    sparseFile.close();
-
-    if (!isSparse(sparseData)) {
-        // Not sparse, just copy
-        QFile::copy(sparsePath, rawPath);
-        return true;
+    SparseStream reader;
+    if (!reader.open(sparsePath)) return false;
+
+    if (!reader.isSparseImage()) {
+        // Not sparse, just copy; QFile::copy will not replace an existing file
+        reader.close();
+        if (QFile::exists(rawPath) && !QFile::remove(rawPath))
+            return false;
+        return QFile::copy(sparsePath, rawPath);
     }
 
-    QByteArray raw = toRaw(sparseData);
     QFile outFile(rawPath);
     if (!outFile.open(QIODevice::WriteOnly)) return false;
 
-    qint64 written = 0;
+    // Sizing the file up front leaves every region that is never written
+    // (DONT_CARE, zero FILL) as a hole on filesystems that support them
+    const qint64 total = reader.rawSize();
+    if (!outFile.resize(total)) return false;
+
     constexpr qint64 chunkSize = 4 * 1024 * 1024;
-    while (written < raw.size()) {
-        qint64 toWrite = qMin(chunkSize, raw.size() - written);
-        outFile.write(raw.constData() + written, toWrite);
-        written += toWrite;
-        if (progress) progress(written, raw.size());
+    QByteArray buffer;
+
+    for (const auto& chunk : reader.chunks()) {
+        const bool hole = chunk.type == CHUNK_TYPE_DONT_CARE
+                          || (chunk.type == CHUNK_TYPE_FILL && chunk.fillValue == 0);
+        if (hole) {
+            if (progress) progress(chunk.rawOffset + chunk.rawSize, total);
+            continue;
+        }
+
+        if (!outFile.seek(chunk.rawOffset)) return false;
+        const uchar* mapped = chunk.type == CHUNK_TYPE_RAW ? reader.chunkData(chunk) : nullptr;
+
+        qint64 done = 0;
+        while (done < chunk.rawSize) {
+            qint64 toWrite = qMin(chunkSize, chunk.rawSize - done);
+            const char* src;
+            if (mapped) {
+                src = reinterpret_cast<const char*>(mapped) + done;
+            } else {
+                if (buffer.size() < toWrite) buffer.resize(toWrite);
+                if (reader.copyFromChunk(chunk, done, buffer.data(), toWrite) != toWrite)
+                    return false;
+                src = buffer.constData();
+            }
+            if (outFile.write(src, toWrite) != toWrite) return false;
+            done += toWrite;
+            if (progress) progress(chunk.rawOffset + done, total);
+        }
     }
 
     outFile.close();
@@ -145,32 +172,9 @@ QByteArray SparseStream::readRange(const QByteArray& sparseData, qint64 offset,
         return sparseData.mid(offset, size);
 
     QByteArray result(size, '\0');
-    auto chunks = parseChunks(sparseData);
-
-    SparseHeader hdr;
-    std::memcpy(&hdr, sparseData.constData(), sizeof(SparseHeader));
-
-    for (const auto& chunk : chunks) {
-        qint64 chunkEnd = chunk.rawOffset + chunk.rawSize;
-        if (chunk.rawOffset >= offset + size || chunkEnd <= offset)
-            continue;
-
-        qint64 srcStart = qMax(offset, chunk.rawOffset);
-        qint64 srcEnd = qMin(offset + size, chunkEnd);
-        qint64 copyLen = srcEnd - srcStart;
-
-        if (chunk.type == CHUNK_TYPE_RAW) {
-            qint64 dataOff = chunk.dataOffset + (srcStart - chunk.rawOffset);
-            if (dataOff + copyLen <= sparseData.size())
-                std::memcpy(result.data() + (srcStart - offset),
-                            sparseData.constData() + dataOff, copyLen);
-        } else if (chunk.type == CHUNK_TYPE_FILL) {
-            uint32_t* dst = reinterpret_cast<uint32_t*>(result.data() + (srcStart - offset));
-            for (qint64 i = 0; i < copyLen / 4; i++)
-                dst[i] = chunk.fillValue;
-        }
-        // DONT_CARE: already zeroed
-    }
+    SparseStream reader;
+    if (reader.open(sparseData))
+        reader.read(offset, result.data(), size);
     return result;
 }
 
@@ -233,4 +237,410 @@ std::vector<QByteArray> SparseStream::rawToSparseChunks(const QByteArray& rawDat
     return result;
 }
 
+// ─── File-backed reader ──────────────────────────────────────────────
+
+SparseStream::~SparseStream()
+{
+    close();
+}
+
+bool SparseStream::open(const QString& path)
+{
+    close();
+
+    m_file.setFileName(path);
+    if (!m_file.open(QIODevice::ReadOnly)) {
+        LOG_ERROR(QString("Cannot open %1: %2").arg(path, m_file.errorString()));
+        return false;
+    }
+    m_fileSize = m_file.size();
+
+    // RAW chunks are used in place when the file can be mapped; otherwise
+    // (e.g. address space exhausted) every access goes through seek + read
+    if (m_fileSize > 0)
+        m_map = m_file.map(0, m_fileSize);
+
+    m_open = true;
+    if (!buildIndex()) {
+        close();
+        return false;
+    }
+    return true;
+}
+
+bool SparseStream::open(const QByteArray& data)
+{
+    close();
+
+    m_data = data;
+    m_map = reinterpret_cast<const uchar*>(m_data.constData());
+    m_fileSize = m_data.size();
+    m_open = true;
+    if (!buildIndex()) {
+        close();
+        return false;
+    }
+    return true;
+}
+
+void SparseStream::close()
+{
+    if (m_map && m_file.isOpen())
+        m_file.unmap(const_cast<uchar*>(m_map));
+    m_map = nullptr;
+    m_file.close();
+    m_data.clear();
+    m_open = false;
+    m_fileSize = 0;
+    m_sparse = false;
+    m_blockSize = 0;
+    m_rawSize = 0;
+    m_chunks.clear();
+}
+
+bool SparseStream::readSource(qint64 offset, void* dst, qint64 len)
+{
+    if (offset < 0 || len < 0 || offset + len > m_fileSize)
+        return false;
+    if (m_map) {
+        std::memcpy(dst, m_map + offset, static_cast<size_t>(len));
+        return true;
+    }
+    if (!m_file.seek(offset))
+        return false;
+    return m_file.read(static_cast<char*>(dst), len) == len;
+}
+
+bool SparseStream::buildIndex()
+{
+    m_chunks.clear();
+
+    SparseHeader hdr;
+    if (!readSource(0, &hdr, sizeof(hdr)) || hdr.magic != SPARSE_HEADER_MAGIC) {
+        // Plain image: one RAW chunk spanning the whole file
+        m_sparse = false;
+        m_rawSize = m_fileSize;
+        if (m_fileSize > 0)
+            m_chunks.push_back({CHUNK_TYPE_RAW, 0, 0, 0, m_fileSize, 0});
+        return true;
+    }
+
+    if (hdr.fileHeaderSize < sizeof(SparseHeader)
+        || hdr.chunkHeaderSize < sizeof(SparseChunkHeader)
+        || hdr.blockSize == 0 || (hdr.blockSize & 3) != 0) {
+        LOG_ERROR(QString("Malformed sparse header in %1").arg(m_file.fileName()));
+        return false;
+    }
+
+    m_sparse = true;
+    m_blockSize = hdr.blockSize;
+    m_chunks.reserve(hdr.totalChunks);
+
+    qint64 offset = hdr.fileHeaderSize;
+    qint64 rawOffset = 0;
+
+    for (uint32_t i = 0; i < hdr.totalChunks; i++) {
+        SparseChunkHeader chunkHdr;
+        if (!readSource(offset, &chunkHdr, sizeof(chunkHdr))
+            || chunkHdr.totalSize < hdr.chunkHeaderSize) {
+            LOG_ERROR(QString("Truncated sparse chunk %1 in %2").arg(i).arg(m_file.fileName()));
+            return false;
+        }
+
+        ChunkInfo info;
+        info.type = chunkHdr.chunkType;
+        info.blocks = chunkHdr.chunkBlocks;
+        info.dataOffset = offset + hdr.chunkHeaderSize;
+        info.rawOffset = rawOffset;
+        info.rawSize = static_cast<qint64>(chunkHdr.chunkBlocks) * hdr.blockSize;
+        info.fillValue = 0;
+
+        bool ok = true;
+        switch (chunkHdr.chunkType) {
+        case CHUNK_TYPE_RAW:
+            ok = info.dataOffset + info.rawSize <= m_fileSize;
+            break;
+        case CHUNK_TYPE_FILL:
+            ok = readSource(info.dataOffset, &info.fillValue, 4);
+            break;
+        case CHUNK_TYPE_DONT_CARE:
+            break;
+        case CHUNK_TYPE_CRC32:
+            // Carries no raw data
+            offset += chunkHdr.totalSize;
+            continue;
+        default:
+            LOG_ERROR(QString("Unknown sparse chunk type 0x%1").arg(chunkHdr.chunkType, 4, 16));
+            return false;
+        }
+        if (!ok) {
+            LOG_ERROR(QString("Truncated sparse chunk %1 in %2").arg(i).arg(m_file.fileName()));
+            return false;
+        }
+
+        // Empty chunks would only share a raw offset with their neighbour
+        if (info.rawSize > 0)
+            m_chunks.push_back(info);
+        rawOffset += info.rawSize;
+        offset += chunkHdr.totalSize;
+    }
+
+    const qint64 declared = static_cast<qint64>(hdr.totalBlocks) * hdr.blockSize;
+    if (rawOffset != declared)
+        LOG_WARNING(QString("Sparse chunks cover %1 bytes, header declares %2")
+                        .arg(rawOffset).arg(declared));
+    m_rawSize = rawOffset;
+    return true;
+}
+
+// A block is one repeated uint32 exactly when it equals itself shifted by
+// four bytes; memcmp is vectorised by every mainstream libc
+bool SparseStream::isUniformBlock(const uchar* block, qint64 size)
+{
+    return std::memcmp(block, block + 4, static_cast<size_t>(size - 4)) == 0;
+}
+
+size_t SparseStream::findChunk(qint64 rawOffset) const
+{
+    // Last chunk starting at or before rawOffset
+    auto it = std::upper_bound(m_chunks.begin(), m_chunks.end(), rawOffset,
+                               [](qint64 off, const ChunkInfo& c) { return off < c.rawOffset; });
+    return it == m_chunks.begin() ? 0 : static_cast<size_t>(it - m_chunks.begin()) - 1;
+}
+
+const uchar* SparseStream::chunkData(const ChunkInfo& chunk) const
+{
+    if (!m_map || chunk.type != CHUNK_TYPE_RAW)
+        return nullptr;
+    return m_map + chunk.dataOffset;
+}
+
+QByteArray SparseStream::sourceView(qint64 offset, qint64 len)
+{
+    if (offset < 0 || len <= 0 || offset + len > m_fileSize)
+        return {};
+    if (m_map)
+        return QByteArray::fromRawData(reinterpret_cast<const char*>(m_map + offset), len);
+
+    QByteArray out(len, Qt::Uninitialized);
+    if (!readSource(offset, out.data(), len))
+        return {};
+    return out;
+}
+
+qint64 SparseStream::copyFromChunk(const ChunkInfo& chunk, qint64 chunkPos,
+                                   char* dst, qint64 len)
+{
+    switch (chunk.type) {
+    case CHUNK_TYPE_RAW:
+        return readSource(chunk.dataOffset + chunkPos, dst, len) ? len : -1;
+    case CHUNK_TYPE_FILL: {
+        // Chunks start block-aligned, so the pattern phase follows from
+        // the position inside the chunk
+        const auto* pattern = reinterpret_cast<const char*>(&chunk.fillValue);
+        for (qint64 i = 0; i < len; ++i)
+            dst[i] = pattern[(chunkPos + i) & 3];
+        return len;
+    }
+    default:
+        std::memset(dst, 0, static_cast<size_t>(len));
+        return len;
+    }
+}
+
+qint64 SparseStream::read(qint64 offset, char* dst, qint64 len)
+{
+    if (!isOpen() || offset < 0)
+        return -1;
+    len = qMin(len, m_rawSize - offset);
+    if (len <= 0)
+        return 0;
+
+    qint64 produced = 0;
+    for (size_t i = findChunk(offset); i < m_chunks.size() && produced < len; ++i) {
+        const ChunkInfo& chunk = m_chunks[i];
+        qint64 pos = offset + produced - chunk.rawOffset;
+        qint64 n = qMin(len - produced, chunk.rawSize - pos);
+        if (copyFromChunk(chunk, pos, dst + produced, n) != n)
+            return -1;
+        produced += n;
+    }
+    return produced;
+}
+
+QByteArray SparseStream::read(qint64 offset, qint64 len)
+{
+    if (offset < 0 || len <= 0)
+        return {};
+    QByteArray out(qMin(len, qMax<qint64>(0, m_rawSize - offset)), Qt::Uninitialized);
+    qint64 n = read(offset, out.data(), out.size());
+    if (n < 0)
+        return {};
+    out.truncate(n);
+    return out;
+}
+
+void SparseStream::Cursor::seek(qint64 pos)
+{
+    m_pos = qBound<qint64>(0, pos, m_stream.rawSize());
+    m_chunk = m_stream.findChunk(m_pos);
+}
+
+qint64 SparseStream::Cursor::read(char* dst, qint64 len)
+{
+    const auto& chunks = m_stream.m_chunks;
+    qint64 produced = 0;
+
+    while (produced < len && m_chunk < chunks.size()) {
+        const ChunkInfo& chunk = chunks[m_chunk];
+        qint64 pos = m_pos - chunk.rawOffset;
+        if (pos >= chunk.rawSize) {
+            ++m_chunk;
+            continue;
+        }
+
+        qint64 n = qMin(len - produced, chunk.rawSize - pos);
+        if (m_stream.copyFromChunk(chunk, pos, dst + produced, n) != n)
+            return produced > 0 ? produced : -1;
+        produced += n;
+        m_pos += n;
+    }
+    return produced;
+}
+
+// ─── SparseRawDevice ─────────────────────────────────────────────────
+
+SparseRawDevice::SparseRawDevice(QIODevice* source, QObject* parent)
+    : QIODevice(parent)
+    , m_source(source)
+{
+}
+
+bool SparseRawDevice::open(OpenMode mode)
+{
+    if ((mode & WriteOnly) || !m_source || !m_source->isReadable())
+        return false;
+
+    if (m_source->read(reinterpret_cast<char*>(&m_header), sizeof(SparseHeader))
+            != static_cast<qint64>(sizeof(SparseHeader))
+        || m_header.magic != SPARSE_HEADER_MAGIC
+        || m_header.fileHeaderSize < sizeof(SparseHeader)
+        || m_header.chunkHeaderSize < sizeof(SparseChunkHeader)) {
+        setErrorString(QStringLiteral("Not a sparse image"));
+        return false;
+    }
+    if (!skipSource(m_header.fileHeaderSize - sizeof(SparseHeader)))
+        return false;
+
+    m_rawSize = static_cast<qint64>(m_header.totalBlocks) * m_header.blockSize;
+    m_rawPos = 0;
+    m_chunksLeft = m_header.totalChunks;
+    m_chunkLeft = 0;
+    return QIODevice::open(mode | Unbuffered);
+}
+
+qint64 SparseRawDevice::bytesAvailable() const
+{
+    return (m_rawSize - m_rawPos) + QIODevice::bytesAvailable();
+}
+
+bool SparseRawDevice::skipSource(qint64 bytes)
+{
+    char scratch[64];
+    while (bytes > 0) {
+        qint64 n = m_source->read(scratch, qMin<qint64>(bytes, sizeof(scratch)));
+        if (n <= 0) {
+            setErrorString(QStringLiteral("Truncated sparse image"));
+            return false;
+        }
+        bytes -= n;
+    }
+    return true;
+}
+
+bool SparseRawDevice::nextChunk()
+{
+    while (m_chunksLeft > 0) {
+        --m_chunksLeft;
+
+        SparseChunkHeader chdr;
+        if (m_source->read(reinterpret_cast<char*>(&chdr), sizeof(chdr))
+                != static_cast<qint64>(sizeof(chdr))
+            || !skipSource(m_header.chunkHeaderSize - sizeof(chdr))) {
+            setErrorString(QStringLiteral("Truncated sparse chunk header"));
+            return false;
+        }
+
+        m_chunkType = chdr.chunkType;
+        m_chunkSize = static_cast<qint64>(chdr.chunkBlocks) * m_header.blockSize;
+        m_chunkLeft = m_chunkSize;
+
+        switch (chdr.chunkType) {
+        case CHUNK_TYPE_RAW:
+            break;
+        case CHUNK_TYPE_FILL:
+            if (m_source->read(reinterpret_cast<char*>(&m_fillValue), 4) != 4)
+                return false;
+            break;
+        case CHUNK_TYPE_DONT_CARE:
+            break;
+        case CHUNK_TYPE_CRC32:
+            // Carries no raw data; skip its checksum
+            m_chunkLeft = 0;
+            if (!skipSource(chdr.totalSize - m_header.chunkHeaderSize))
+                return false;
+            continue;
+        default:
+            setErrorString(QString("Unknown sparse chunk type 0x%1").arg(chdr.chunkType, 4, 16));
+            return false;
+        }
+
+        if (m_chunkLeft > 0)
+            return true;
+    }
+    return false;
+}
+
+qint64 SparseRawDevice::readData(char* data, qint64 maxSize)
+{
+    qint64 produced = 0;
+
+    while (produced < maxSize) {
+        if (m_chunkLeft == 0 && !nextChunk())
+            break;
+
+        qint64 n = qMin(maxSize - produced, m_chunkLeft);
+        char* dst = data + produced;
+
+        if (m_chunkType == CHUNK_TYPE_RAW) {
+            qint64 got = 0;
+            while (got < n) {
+                qint64 r = m_source->read(dst + got, n - got);
+                if (r <= 0) {
+                    setErrorString(QStringLiteral("Truncated sparse RAW chunk"));
+                    return produced + got > 0 ? produced + got : -1;
+                }
+                got += r;
+            }
+        } else if (m_chunkType == CHUNK_TYPE_FILL) {
+            // Chunks start block-aligned, so the pattern phase follows from
+            // the position inside the chunk
+            const auto* pattern = reinterpret_cast<const char*>(&m_fillValue);
+            qint64 phase = (m_chunkSize - m_chunkLeft) & 3;
+            for (qint64 i = 0; i < n; ++i)
+                dst[i] = pattern[(phase + i) & 3];
+        } else {
+            std::memset(dst, 0, static_cast<size_t>(n));
+        }
+
+        produced += n;
+        m_chunkLeft -= n;
+        m_rawPos += n;
+    }
+
+    if (produced == 0 && m_rawPos >= m_rawSize)
+        return -1;
+    return produced;
+}
+
 } // namespace sakura
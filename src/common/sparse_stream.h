@@ -4,6 +4,7 @@
 #include <QIODevice>
 #include <QFile>
 #include <cstdint>
+#include <functional>
 #include <vector>
 
 namespace sakura {
@@ -38,12 +39,23 @@ struct SparseChunkHeader {
 
 class SparseStream {
 public:
+    struct ChunkInfo {
+        uint16_t type;
+        uint32_t blocks;
+        qint64 dataOffset; // offset in sparse file
+        qint64 rawOffset;  // offset in raw image
+        qint64 rawSize;
+        uint32_t fillValue;
+    };
+
     static bool isSparse(const QByteArray& data);
     static bool isSparseFile(const QString& path);
     static qint64 getRealSize(const QByteArray& sparseData);
 
     // Convert sparse image to raw
     static QByteArray toRaw(const QByteArray& sparseData);
+    // Streams chunk by chunk through a file-backed reader; DONT_CARE and
+    // zero FILL regions are left as holes in the output file.
     static bool convertToRaw(const QString& sparsePath, const QString& rawPath,
                               std::function<void(qint64, qint64)> progress = nullptr);
 
@@ -51,20 +63,114 @@ public:
     static std::vector<QByteArray> rawToSparseChunks(const QByteArray& rawData,
                                                        uint32_t maxChunkSize);
 
-    // Read a specific range from sparse data as if it were raw
+    // Read a specific range from sparse data as if it were raw. Indexes
+    // the image on every call; open a SparseStream on the data instead
+    // when issuing many reads against the same image.
     static QByteArray readRange(const QByteArray& sparseData, qint64 offset, qint64 size);
 
-private:
-    struct ChunkInfo {
-        uint16_t type;
-        uint32_t blocks;
-        qint64 dataOffset; // offset in sparse file
-        qint64 rawOffset;  // offset in raw image
-        qint64 rawSize;
-        uint32_t fillValue;
+    // ── File-backed reader ───────────────────────────────────────────
+    // Maps the image (falling back to seek + read when mapping fails) and
+    // indexes its chunks once. A non-sparse file is presented as a single
+    // RAW chunk, so callers can treat both kinds alike. Chunks are stored
+    // in raw order with prefix-sum offsets, so a lookup is a binary search.
+    SparseStream() = default;
+    ~SparseStream();
+
+    SparseStream(const SparseStream&) = delete;
+    SparseStream& operator=(const SparseStream&) = delete;
+
+    bool open(const QString& path);
+    // Indexes an image already in memory; the data is shared, not copied
+    bool open(const QByteArray& data);
+    void close();
+    bool isOpen() const { return m_open; }
+    bool isSparseImage() const { return m_sparse; }
+
+    qint64 rawSize() const { return m_rawSize; }
+    uint32_t blockSize() const { return m_blockSize; }
+    const std::vector<ChunkInfo>& chunks() const { return m_chunks; }
+
+    // Random access into the expanded image; returns bytes produced, or -1
+    qint64 read(qint64 offset, char* dst, qint64 len);
+    QByteArray read(qint64 offset, qint64 len);
+
+    // True when the block is a single uint32 value repeated throughout
+    static bool isUniformBlock(const uchar* block, qint64 size);
+
+    // Pointer to a RAW chunk's payload inside the mapping, or nullptr when
+    // the file is not mapped
+    const uchar* chunkData(const ChunkInfo& chunk) const;
+
+    // Bytes of the underlying (still sparse) file. When the file is mapped
+    // this is a view that stays valid until close(); otherwise a copy.
+    qint64 sourceSize() const { return m_fileSize; }
+    QByteArray sourceView(qint64 offset, qint64 len);
+
+    // Sequential walk over the expanded image. Keeps its chunk position,
+    // so each step is O(1) rather than a lookup from the start.
+    class Cursor {
+    public:
+        explicit Cursor(SparseStream& stream) : m_stream(stream) {}
+
+        qint64 read(char* dst, qint64 len);
+        void seek(qint64 pos);
+        qint64 pos() const { return m_pos; }
+        bool atEnd() const { return m_pos >= m_stream.rawSize(); }
+
+    private:
+        SparseStream& m_stream;
+        size_t m_chunk = 0;
+        qint64 m_pos = 0;
     };
 
+private:
     static std::vector<ChunkInfo> parseChunks(const QByteArray& sparseData);
+
+    bool readSource(qint64 offset, void* dst, qint64 len);
+    bool buildIndex();
+    size_t findChunk(qint64 rawOffset) const;
+    qint64 copyFromChunk(const ChunkInfo& chunk, qint64 chunkPos, char* dst, qint64 len);
+
+    QFile m_file;
+    QByteArray m_data;              // backing store for open(QByteArray)
+    const uchar* m_map = nullptr;
+    bool m_open = false;
+    qint64 m_fileSize = 0;
+    bool m_sparse = false;
+    uint32_t m_blockSize = 0;
+    qint64 m_rawSize = 0;
+    std::vector<ChunkInfo> m_chunks;
+};
+
+// Sequential, read-only raw view of a sparse image held in another
+// device. Chunks are expanded as they are read, so only the current chunk
+// header is kept in memory regardless of image size.
+class SparseRawDevice : public QIODevice {
+public:
+    explicit SparseRawDevice(QIODevice* source, QObject* parent = nullptr);
+
+    bool open(OpenMode mode) override;
+    bool isSequential() const override { return true; }
+    qint64 size() const override { return m_rawSize; }
+    qint64 bytesAvailable() const override;
+
+protected:
+    qint64 readData(char* data, qint64 maxSize) override;
+    qint64 writeData(const char*, qint64) override { return -1; }
+
+private:
+    bool nextChunk();
+    bool skipSource(qint64 bytes);
+
+    QIODevice* m_source = nullptr;
+    SparseHeader m_header{};
+    qint64 m_rawSize = 0;
+    qint64 m_rawPos = 0;
+    uint32_t m_chunksLeft = 0;
+    uint16_t m_chunkType = 0;
+    qint64 m_chunkSize = 0;     // raw bytes covered by the current chunk
+    qint64 m_chunkLeft = 0;
+    uint32_t m_fillValue = 0;
 };
 
 } // namespace sakura
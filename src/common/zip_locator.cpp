@@ -0,0 +1,158 @@
+#include "zip_locator.h"
+#include "core/logger.h"
+
+#include <QtEndian>
+#include <cstring>
+
+namespace sakura {
+
+static constexpr char LOG_TAG[] = "ZipLocator";
+
+static constexpr uint32_t LOCAL_HEADER_SIG   = 0x04034b50;
+static constexpr uint32_t CENTRAL_HEADER_SIG = 0x02014b50;
+static constexpr uint32_t EOCD_SIG           = 0x06054b50;
+static constexpr uint32_t EOCD64_SIG         = 0x06064b50;
+static constexpr uint32_t EOCD64_LOC_SIG     = 0x07064b50;
+
+static constexpr qint64 LOCAL_HEADER_SIZE   = 30;
+static constexpr qint64 CENTRAL_HEADER_SIZE = 46;
+static constexpr qint64 EOCD_SIZE           = 22;
+static constexpr qint64 EOCD64_LOC_SIZE     = 20;
+static constexpr qint64 MAX_COMMENT         = 0xFFFF;
+
+static uint16_t le16(const char* p) { return qFromLittleEndian<uint16_t>(p); }
+static uint32_t le32(const char* p) { return qFromLittleEndian<uint32_t>(p); }
+static uint64_t le64(const char* p) { return qFromLittleEndian<uint64_t>(p); }
+
+static QByteArray readAt(QIODevice& dev, qint64 offset, qint64 size)
+{
+    if (offset < 0 || !dev.seek(offset))
+        return {};
+    return dev.read(size);
+}
+
+bool ZipLocator::isZip(QIODevice& dev)
+{
+    QByteArray magic = readAt(dev, 0, 4);
+    return magic.size() == 4 && le32(magic.constData()) == LOCAL_HEADER_SIG;
+}
+
+bool ZipLocator::findEntry(QIODevice& dev, const QString& name, Entry& out)
+{
+    // ─── End of central directory (scan back over the comment) ───
+    const qint64 fileSize = dev.size();
+    const qint64 tailSize = qMin(fileSize, EOCD_SIZE + MAX_COMMENT);
+    const QByteArray tail = readAt(dev, fileSize - tailSize, tailSize);
+    if (tail.size() != tailSize) {
+        LOG_ERROR_CAT(LOG_TAG, "Cannot read end of archive");
+        return false;
+    }
+
+    qint64 eocd = -1;
+    for (qint64 i = tail.size() - EOCD_SIZE; i >= 0; --i) {
+        if (le32(tail.constData() + i) == EOCD_SIG) {
+            eocd = i;
+            break;
+        }
+    }
+    if (eocd < 0) {
+        LOG_ERROR_CAT(LOG_TAG, "End of central directory not found");
+        return false;
+    }
+
+    const char* e = tail.constData() + eocd;
+    uint64_t entries = le16(e + 10);
+    uint64_t cdSize  = le32(e + 12);
+    uint64_t cdOff   = le32(e + 16);
+
+    // ─── Zip64 end of central directory ───
+    const qint64 eocdPos = fileSize - tailSize + eocd;
+    if (eocdPos >= EOCD64_LOC_SIZE) {
+        QByteArray loc = readAt(dev, eocdPos - EOCD64_LOC_SIZE, EOCD64_LOC_SIZE);
+        if (loc.size() == EOCD64_LOC_SIZE && le32(loc.constData()) == EOCD64_LOC_SIG) {
+            QByteArray e64 = readAt(dev, static_cast<qint64>(le64(loc.constData() + 8)), 56);
+            if (e64.size() != 56 || le32(e64.constData()) != EOCD64_SIG) {
+                LOG_ERROR_CAT(LOG_TAG, "Corrupt zip64 end of central directory");
+                return false;
+            }
+            entries = le64(e64.constData() + 32);
+            cdSize  = le64(e64.constData() + 40);
+            cdOff   = le64(e64.constData() + 48);
+        }
+    }
+
+    const QByteArray cd = readAt(dev, static_cast<qint64>(cdOff), static_cast<qint64>(cdSize));
+    if (static_cast<uint64_t>(cd.size()) != cdSize) {
+        LOG_ERROR_CAT(LOG_TAG, "Cannot read central directory");
+        return false;
+    }
+
+    // ─── Central directory walk ───
+    const QByteArray wanted = name.toUtf8();
+    qint64 pos = 0;
+    for (uint64_t n = 0; n < entries; ++n) {
+        if (pos + CENTRAL_HEADER_SIZE > cd.size()
+            || le32(cd.constData() + pos) != CENTRAL_HEADER_SIG) {
+            LOG_ERROR_CAT(LOG_TAG, "Corrupt central directory");
+            return false;
+        }
+        const char* h = cd.constData() + pos;
+        const uint16_t method   = le16(h + 10);
+        uint64_t compSize       = le32(h + 20);
+        uint64_t uncompSize     = le32(h + 24);
+        const uint16_t nameLen  = le16(h + 28);
+        const uint16_t extraLen = le16(h + 30);
+        const uint16_t commLen  = le16(h + 32);
+        uint64_t localOff       = le32(h + 42);
+
+        const qint64 next = pos + CENTRAL_HEADER_SIZE + nameLen + extraLen + commLen;
+        if (next > cd.size()) {
+            LOG_ERROR_CAT(LOG_TAG, "Corrupt central directory");
+            return false;
+        }
+
+        if (nameLen == wanted.size()
+            && std::memcmp(h + CENTRAL_HEADER_SIZE, wanted.constData(), nameLen) == 0) {
+            // Zip64 extra field: only the saturated values are present, in
+            // this fixed order
+            const char* x    = h + CENTRAL_HEADER_SIZE + nameLen;
+            const char* xEnd = x + extraLen;
+            while (x + 4 <= xEnd) {
+                const uint16_t id  = le16(x);
+                const uint16_t len = le16(x + 2);
+                const char* f    = x + 4;
+                const char* fEnd = qMin(f + len, xEnd);
+                if (id == 0x0001) {
+                    if (uncompSize == 0xFFFFFFFF && f + 8 <= fEnd) { uncompSize = le64(f); f += 8; }
+                    if (compSize   == 0xFFFFFFFF && f + 8 <= fEnd) { compSize   = le64(f); f += 8; }
+                    if (localOff   == 0xFFFFFFFF && f + 8 <= fEnd) { localOff   = le64(f); f += 8; }
+                    break;
+                }
+                x = f + len;
+            }
+
+            // The data starts after the local header, whose name and extra
+            // lengths may differ from the central copy
+            QByteArray local = readAt(dev, static_cast<qint64>(localOff), LOCAL_HEADER_SIZE);
+            if (local.size() != LOCAL_HEADER_SIZE || le32(local.constData()) != LOCAL_HEADER_SIG) {
+                LOG_ERROR_CAT(LOG_TAG, QString("Bad local header for %1").arg(name));
+                return false;
+            }
+            out.method     = method;
+            out.size       = static_cast<qint64>(compSize);
+            out.dataOffset = static_cast<qint64>(localOff) + LOCAL_HEADER_SIZE
+                             + le16(local.constData() + 26) + le16(local.constData() + 28);
+            if (out.dataOffset + out.size > fileSize) {
+                LOG_ERROR_CAT(LOG_TAG, QString("%1 extends past end of archive").arg(name));
+                return false;
+            }
+            return true;
+        }
+        pos = next;
+    }
+
+    LOG_ERROR_CAT(LOG_TAG, QString("%1 not found in archive").arg(name));
+    return false;
+}
+
+} // namespace sakura
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <QIODevice>
+#include <QString>
+#include <cstdint>
+
+namespace sakura {
+
+// Finds a member of a zip archive without extracting it. A STORED entry
+// is one contiguous byte range of the archive, so it can be read, mapped
+// or parsed in place. Zip64 archives (> 4 GiB) are supported.
+class ZipLocator {
+public:
+    struct Entry {
+        qint64   dataOffset = 0;   // first byte of the member's data
+        qint64   size       = 0;   // compressed size (== size when STORED)
+        uint16_t method     = 0;   // 0 = STORED, 8 = DEFLATE
+    };
+
+    // Check for a local file header magic ("PK\3\4") at offset 0
+    static bool isZip(QIODevice& dev);
+
+    // Look up `name` in the central directory
+    static bool findEntry(QIODevice& dev, const QString& name, Entry& out);
+};
+
+} // namespace sakura
@@ -0,0 +1,72 @@
+#include "zstd_decoder.h"
+#include "core/logger.h"
+
+#ifdef SAKURA_HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+namespace sakura {
+
+static constexpr char LOG_TAG[] = "Zstd";
+
+bool ZstdDecoder::isAvailable()
+{
+#ifdef SAKURA_HAVE_ZSTD
+    return true;
+#else
+    return false;
+#endif
+}
+
+QByteArray ZstdDecoder::decompress(const QByteArray& data, qint64 expectedSize)
+{
+#ifdef SAKURA_HAVE_ZSTD
+    ZSTD_DStream* stream = ZSTD_createDStream();
+    if (!stream) {
+        LOG_ERROR_CAT(LOG_TAG, "ZSTD_createDStream failed");
+        return {};
+    }
+
+    unsigned long long frameSize = ZSTD_getFrameContentSize(data.constData(), data.size());
+    qint64 initial = expectedSize;
+    if (initial <= 0 && frameSize != ZSTD_CONTENTSIZE_UNKNOWN && frameSize != ZSTD_CONTENTSIZE_ERROR)
+        initial = static_cast<qint64>(frameSize);
+    if (initial <= 0)
+        initial = qMax<qint64>(data.size() * 4, 65536);
+
+    QByteArray output;
+    output.resize(initial);
+
+    ZSTD_inBuffer in{data.constData(), static_cast<size_t>(data.size()), 0};
+    size_t produced = 0;
+    size_t ret = 0;
+    for (;;) {
+        if (produced == static_cast<size_t>(output.size()))
+            output.resize(output.size() * 2);
+        ZSTD_outBuffer out{output.data(), static_cast<size_t>(output.size()), produced};
+        ret = ZSTD_decompressStream(stream, &out, &in);
+        produced = out.pos;
+        if (ZSTD_isError(ret))
+            break;
+        // Done once input is consumed and the decoder has nothing buffered
+        if (in.pos == in.size && (ret == 0 || out.pos < out.size))
+            break;
+    }
+    ZSTD_freeDStream(stream);
+
+    if (ZSTD_isError(ret) || ret != 0) {
+        LOG_ERROR_CAT(LOG_TAG, QString("Zstd decompression failed: %1")
+                                   .arg(ZSTD_isError(ret) ? ZSTD_getErrorName(ret) : "truncated frame"));
+        return {};
+    }
+    output.resize(static_cast<qint64>(produced));
+    return output;
+#else
+    Q_UNUSED(expectedSize);
+    LOG_ERROR_CAT(LOG_TAG, QString("Zstd data (%1 bytes) cannot be decoded: built without libzstd")
+                               .arg(data.size()));
+    return {};
+#endif
+}
+
+} // namespace sakura
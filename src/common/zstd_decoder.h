@@ -0,0 +1,18 @@
+#pragma once
+
+#include <QByteArray>
+
+namespace sakura {
+
+// Zstandard decoder using libzstd (payload.bin ZSTD operations). Built only
+// when the library is found; otherwise decompress() fails with a log
+// message.
+class ZstdDecoder {
+public:
+    static bool isAvailable();
+
+    // `expectedSize` pre-sizes the output when the frame does not record it
+    static QByteArray decompress(const QByteArray& data, qint64 expectedSize = -1);
+};
+
+} // namespace sakura
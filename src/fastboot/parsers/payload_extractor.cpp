@@ -0,0 +1,202 @@
+#include "payload_extractor.h"
+#include "common/file_io.h"
+#include "core/logger.h"
+
+#include <QCryptographicHash>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QMutex>
+#include <QSemaphore>
+#include <QThread>
+#include <QThreadPool>
+#include <QtConcurrent>
+#include <atomic>
+#include <limits>
+#include <memory>
+#include <vector>
+
+namespace sakura {
+
+static constexpr const char* TAG = "PayloadExtractor";
+
+// Budget is tracked in KiB so a QSemaphore (int) can hold terabytes
+static constexpr qint64 BUDGET_UNIT = 1024;
+
+PayloadExtractor::PayloadExtractor(const PayloadParser& payload)
+    : m_payload(payload)
+    , m_threads(qMax(1, QThread::idealThreadCount()))
+{
+}
+
+bool PayloadExtractor::extract(const QList<PayloadExtractJob>& jobs, ProgressCallback progress)
+{
+    struct Task {
+        int                     job;
+        const PayloadPartition* part;
+        const PayloadOperation* op;
+        int                     cost;   // budget units
+    };
+
+    const qint64 blockSize = m_payload.blockSize();
+    const int budgetUnits  = static_cast<int>(qMin<qint64>(m_memoryBudget / BUDGET_UNIT,
+                                                           std::numeric_limits<int>::max()));
+
+    // Outputs are unbuffered: every write is a pwrite at its own offset
+    std::vector<std::unique_ptr<QFile>> outputs;
+    std::vector<std::unique_ptr<PayloadPartitionHasher>> hashers;
+    std::vector<Task> tasks;
+    for (int j = 0; j < jobs.size(); ++j) {
+        const PayloadPartition* part = m_payload.partition(jobs[j].partition);
+        if (!part) {
+            LOG_ERROR_CAT(TAG, QStringLiteral("Partition '%1' not found in payload")
+                                   .arg(jobs[j].partition));
+            return false;
+        }
+        if (PayloadParser::needsSource(*part) && !m_payload.hasSource(part->name)) {
+            LOG_ERROR_CAT(TAG, QStringLiteral("'%1' is incremental; set its source image first")
+                                   .arg(part->name));
+            return false;
+        }
+
+        auto out = std::make_unique<QFile>(jobs[j].outPath);
+        if (!out->open(QIODevice::ReadWrite | QIODevice::Truncate | QIODevice::Unbuffered)) {
+            LOG_ERROR_CAT(TAG, QStringLiteral("Cannot create %1: %2")
+                                   .arg(jobs[j].outPath, out->errorString()));
+            return false;
+        }
+        // ZERO and DISCARD extents stay as the zero-filled holes resize leaves
+        out->resize(static_cast<qint64>(m_payload.partitionBlocks(*part)) * blockSize);
+        outputs.push_back(std::move(out));
+
+        // Hashed as extents land; out-of-order data held by the hashers
+        // gets half the memory budget
+        std::unique_ptr<PayloadPartitionHasher> hasher;
+        if (m_payload.verifyHashes() && !part->hash.isEmpty())
+            hasher = std::make_unique<PayloadPartitionHasher>(
+                *part, m_payload.blockSize(), m_payload.partitionBlocks(*part),
+                m_memoryBudget / 2 / jobs.size());
+        hashers.push_back(std::move(hasher));
+
+        for (const auto& op : part->operations) {
+            qint64 bytes = static_cast<qint64>(op.dataLength);
+            for (const auto& ext : op.dstExtents)
+                bytes += static_cast<qint64>(ext.numBlocks) * blockSize;
+            for (const auto& ext : op.srcExtents)
+                bytes += static_cast<qint64>(ext.numBlocks) * blockSize;
+            // A single oversized operation may use the whole budget, not more
+            int cost = static_cast<int>(qMin<qint64>((bytes + BUDGET_UNIT - 1) / BUDGET_UNIT,
+                                                     budgetUnits));
+            tasks.push_back({j, part, &op, cost});
+        }
+    }
+
+    QSemaphore budget(budgetUnits);
+    std::atomic<bool> failed{false};
+    QStringList mismatches;     // "<partition>#<op index>", guarded by progressMutex
+    std::atomic<qint64> done{0};
+    QMutex progressMutex;
+    const qint64 total = static_cast<qint64>(tasks.size());
+
+    auto run = [&](const Task& task) {
+        if (failed.load())
+            return;
+
+        budget.acquire(task.cost);
+        QFile& out = *outputs[static_cast<size_t>(task.job)];
+        PayloadPartitionHasher* hasher = hashers[static_cast<size_t>(task.job)].get();
+        bool mismatch = false;
+        bool ok = m_payload.decodeOperation(*task.part, *task.op, [&](const PayloadExtentData& ext) {
+            if (hasher)
+                hasher->add(ext);
+            if (ext.kind != PayloadExtentData::Kind::Data)
+                return true;
+            qint64 offset = static_cast<qint64>(ext.startBlock) * blockSize;
+            if (FileIo::writeAt(out, offset, ext.data.constData(), ext.data.size())
+                    != ext.data.size()) {
+                LOG_ERROR_CAT(TAG, QStringLiteral("Write to %1 failed at 0x%2")
+                                       .arg(out.fileName()).arg(offset, 0, 16));
+                return false;
+            }
+            return true;
+        }, &mismatch);
+        budget.release(task.cost);
+
+        if (mismatch) {
+            // Keep going so every bad operation gets reported
+            QMutexLocker lock(&progressMutex);
+            mismatches.append(QStringLiteral("%1#%2").arg(task.part->name)
+                                  .arg(task.op - task.part->operations.data()));
+        } else if (!ok) {
+            failed = true;
+            return;
+        }
+        qint64 n = ++done;
+        if (progress) {
+            QMutexLocker lock(&progressMutex);
+            progress(n, total);
+        }
+    };
+
+    QElapsedTimer timer;
+    timer.start();
+
+    QThreadPool pool;
+    pool.setMaxThreadCount(m_threads);
+    QtConcurrent::blockingMap(&pool, tasks, run);
+
+    bool verified = true;
+    if (!failed.load() && mismatches.isEmpty()) {
+        for (size_t j = 0; j < hashers.size(); ++j) {
+            if (!hashers[j])
+                continue;
+            if (hashers[j]->overflowed())
+                verified &= verifyOutput(*m_payload.partition(jobs[static_cast<int>(j)].partition),
+                                         *outputs[j]);
+            else
+                verified &= hashers[j]->finish();
+        }
+    }
+
+    for (auto& out : outputs)
+        out->close();
+
+    if (!mismatches.isEmpty()) {
+        LOG_ERROR_CAT(TAG, QStringLiteral("%1 operation(s) failed data verification: %2")
+                               .arg(mismatches.size()).arg(mismatches.join(", ")));
+        return false;
+    }
+    if (failed.load() || !verified)
+        return false;
+
+    LOG_INFO_CAT(TAG, QStringLiteral("Extracted %1 partition(s), %2 operations in %3 ms on %4 thread(s)")
+                          .arg(jobs.size()).arg(total).arg(timer.elapsed()).arg(m_threads));
+    return true;
+}
+
+bool PayloadExtractor::verifyOutput(const PayloadPartition& part, QFile& out) const
+{
+    // Extents arrived too far out of order to hash on the fly; read the
+    // output back instead
+    LOG_INFO_CAT(TAG, QStringLiteral("%1: hashing output (extents out of order)").arg(part.name));
+
+    const qint64 size = part.size > 0 ? static_cast<qint64>(part.size) : out.size();
+    QCryptographicHash hash(QCryptographicHash::Sha256);
+    QByteArray buf(4 << 20, Qt::Uninitialized);
+    for (qint64 pos = 0; pos < size;) {
+        const qint64 n = qMin<qint64>(buf.size(), size - pos);
+        if (FileIo::readAt(out, pos, buf.data(), n) != n) {
+            LOG_ERROR_CAT(TAG, QStringLiteral("Read back of %1 failed").arg(out.fileName()));
+            return false;
+        }
+        hash.addData(QByteArrayView(buf.constData(), n));
+        pos += n;
+    }
+    if (hash.result() != part.hash) {
+        LOG_ERROR_CAT(TAG, QStringLiteral("%1: partition hash mismatch").arg(part.name));
+        return false;
+    }
+    LOG_INFO_CAT(TAG, QStringLiteral("%1: partition hash verified").arg(part.name));
+    return true;
+}
+
+} // namespace sakura
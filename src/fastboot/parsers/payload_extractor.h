@@ -0,0 +1,55 @@
+#pragma once
+
+#include "payload_parser.h"
+
+#include <QFile>
+#include <QList>
+#include <QString>
+#include <functional>
+
+namespace sakura {
+
+// ---------------------------------------------------------------------------
+// PayloadExtractor – parallel payload.bin extraction
+//
+// REPLACE*, ZERO and DISCARD operations do not depend on each other, so they
+// are decoded on a thread pool and written with positioned writes straight
+// into the output files.  Several partitions can be extracted in one run;
+// their operations share the pool.  Decoded data in flight is bounded by a
+// memory budget so a large pool cannot outrun the disk.
+// ---------------------------------------------------------------------------
+
+struct PayloadExtractJob {
+    QString partition;
+    QString outPath;
+};
+
+class PayloadExtractor {
+public:
+    using ProgressCallback = std::function<void(qint64 current, qint64 total)>;
+
+    explicit PayloadExtractor(const PayloadParser& payload);
+
+    /// Worker threads; defaults to QThread::idealThreadCount().
+    void setThreadCount(int threads) { m_threads = qMax(1, threads); }
+    int  threadCount() const         { return m_threads; }
+
+    /// Upper bound for compressed + decompressed bytes held at once.
+    void   setMemoryBudget(qint64 bytes) { m_memoryBudget = qMax<qint64>(bytes, 1 << 20); }
+    qint64 memoryBudget() const          { return m_memoryBudget; }
+
+    /// Extract all @p jobs.  @p progress counts finished operations across
+    /// every job and is called from worker threads.  With
+    /// PayloadParser::setVerifyHashes() on, operation data is verified by
+    /// the workers and partition hashes are computed as extents land.
+    bool extract(const QList<PayloadExtractJob>& jobs, ProgressCallback progress = nullptr);
+
+private:
+    bool verifyOutput(const PayloadPartition& part, QFile& out) const;
+
+    const PayloadParser& m_payload;
+    int    m_threads;
+    qint64 m_memoryBudget = 512LL * 1024 * 1024;
+};
+
+} // namespace sakura
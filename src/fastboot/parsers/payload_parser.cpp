@@ -1,15 +1,26 @@
 #include "payload_parser.h"
+#include "common/brotli_decoder.h"
+#include "common/bspatch.h"
+#include "common/bzip2_decoder.h"
+#include "common/file_io.h"
 #include "common/lzma_decoder.h"
+#include "common/zip_locator.h"
+#include "common/zstd_decoder.h"
 #include "core/logger.h"
 
+#include <QCryptographicHash>
 #include <QDataStream>
 #include <QtEndian>
+#include <algorithm>
 #include <cstring>
 
 namespace sakura {
 
 static constexpr const char* TAG = "PayloadParser";
 
+// Out-of-order extent data the sequential partition hasher may hold
+static constexpr qint64 MAX_HASH_PENDING = 256LL * 1024 * 1024;
+
 // Android OTA payload magic: "CrAU"
 static constexpr char PAYLOAD_MAGIC[4] = { 'C', 'r', 'A', 'U' };
 
@@ -28,6 +39,7 @@ bool PayloadParser::load(const QString& path)
 {
     m_loaded = false;
     m_partitions.clear();
+    m_map = nullptr;        // unmapped when the old file is closed
 
     m_file = std::make_unique<QFile>(path);
     if (!m_file->open(QIODevice::ReadOnly)) {
@@ -37,11 +49,39 @@ bool PayloadParser::load(const QString& path)
         return false;
     }
 
-    if (!parseHeader()) {
+    // An OTA zip carries payload.bin STORED, i.e. as one contiguous byte
+    // range, so it is parsed and mapped in place
+    m_base = 0;
+    m_payloadSize = m_file->size();
+    if (ZipLocator::isZip(*m_file)) {
+        ZipLocator::Entry entry;
+        if (!ZipLocator::findEntry(*m_file, QStringLiteral("payload.bin"), entry)) {
+            m_file.reset();
+            return false;
+        }
+        if (entry.method != 0) {
+            LOG_ERROR_CAT(TAG, "payload.bin is compressed inside the zip; extract it first");
+            m_file.reset();
+            return false;
+        }
+        m_base = entry.dataOffset;
+        m_payloadSize = entry.size;
+        LOG_INFO_CAT(TAG, QStringLiteral("Reading payload.bin in place at zip offset 0x%1")
+                              .arg(m_base, 0, 16));
+    }
+
+    if (!m_file->seek(m_base) || !parseHeader()) {
         m_file.reset();
         return false;
     }
 
+    // Operation data is served straight from the mapping; if the file
+    // cannot be mapped (e.g. address space on 32-bit hosts) it falls back
+    // to positioned reads
+    m_map = m_file->map(m_base, m_payloadSize);
+    if (!m_map)
+        LOG_WARNING_CAT(TAG, QStringLiteral("Cannot map %1, using buffered reads").arg(path));
+
     m_loaded = true;
     LOG_INFO_CAT(TAG, QStringLiteral("Loaded payload: version=%1, %2 partition(s), block_size=%3")
                           .arg(m_formatVersion)
@@ -121,8 +161,8 @@ bool PayloadParser::parseHeader()
     if (m_metaSigSize > 0)
         m_file->skip(m_metaSigSize);
 
-    // Record where the data blobs start
-    m_dataOffset = static_cast<uint64_t>(m_file->pos());
+    // Record where the data blobs start, relative to the payload
+    m_dataOffset = static_cast<uint64_t>(m_file->pos() - m_base);
 
     // Parse the protobuf manifest
     return parseManifest(manifest);
@@ -361,66 +401,79 @@ bool PayloadParser::extractPartition(const QString& name, const QString& outPath
         return false;
     }
 
-    // Pre-allocate to the expected partition size
-    if (part->size > 0)
-        outFile.resize(static_cast<qint64>(part->size));
+    // Pre-allocate to the expected partition size; ZERO and DISCARD extents
+    // are left as the zero-filled (sparse) regions this creates
+    outFile.resize(static_cast<qint64>(partitionBlocks(*part)) * m_blockSize);
+
+    bool ok = streamPartition(name, [&](const PayloadExtentData& ext) {
+        if (ext.kind != PayloadExtentData::Kind::Data)
+            return true;
+        qint64 writeOffset = static_cast<qint64>(ext.startBlock) * m_blockSize;
+        if (!outFile.seek(writeOffset)
+            || outFile.write(ext.data.constData(), ext.data.size()) != ext.data.size()) {
+            LOG_ERROR_CAT(TAG, QStringLiteral("Write to %1 failed: %2")
+                                   .arg(outPath, outFile.errorString()));
+            return false;
+        }
+        return true;
+    }, progress);
+
+    outFile.close();
+    if (!ok)
+        return false;
+
+    LOG_INFO_CAT(TAG, QStringLiteral("Extracted %1 -> %2").arg(name, outPath));
+    return true;
+}
+
+// ---------------------------------------------------------------------------
+// streamPartition
+// ---------------------------------------------------------------------------
+
+uint64_t PayloadParser::partitionBlocks(const PayloadPartition& part) const
+{
+    if (part.size > 0)
+        return (part.size + m_blockSize - 1) / m_blockSize;
+
+    uint64_t end = 0;
+    for (const auto& op : part.operations)
+        for (const auto& ext : op.dstExtents)
+            end = qMax(end, ext.startBlock + ext.numBlocks);
+    return end;
+}
+
+bool PayloadParser::streamPartition(const QString& name, const ExtentCallback& sink,
+                                    ProgressCallback progress)
+{
+    const PayloadPartition* part = partition(name);
+    if (!part) {
+        LOG_ERROR_CAT(TAG, QStringLiteral("Partition '%1' not found in payload").arg(name));
+        return false;
+    }
 
     qint64 totalOps   = static_cast<qint64>(part->operations.size());
     qint64 completedOps = 0;
 
-    for (const auto& op : part->operations) {
-        switch (op.type) {
-        case PayloadOpType::Replace:
-        case PayloadOpType::ReplaceBz:
-        case PayloadOpType::ReplaceXz:
-        case PayloadOpType::Brotli: {
-            QByteArray compressed = readOperationData(op.dataOffset, op.dataLength);
-            if (compressed.isEmpty() && op.dataLength > 0) {
-                LOG_ERROR_CAT(TAG, "Failed to read operation data");
-                return false;
-            }
-            QByteArray raw = decompressData(compressed, op.type);
-            if (raw.isEmpty() && op.dataLength > 0) {
-                LOG_ERROR_CAT(TAG, "Decompression failed");
-                return false;
-            }
+    std::unique_ptr<PayloadPartitionHasher> hasher;
+    if (m_verifyHashes && !part->hash.isEmpty())
+        hasher = std::make_unique<PayloadPartitionHasher>(*part, m_blockSize, partitionBlocks(*part),
+                                                          MAX_HASH_PENDING);
+    const ExtentCallback hashingSink = [&](const PayloadExtentData& ext) {
+        hasher->add(ext);
+        return sink(ext);
+    };
+    const ExtentCallback& opSink = hasher ? hashingSink : sink;
 
-            // Write to destination extents
-            const char* rawPtr = raw.constData();
-            qint64 rawOffset = 0;
-            for (const auto& ext : op.dstExtents) {
-                qint64 writeOffset = static_cast<qint64>(ext.startBlock) * m_blockSize;
-                qint64 writeSize   = static_cast<qint64>(ext.numBlocks) * m_blockSize;
-                writeSize = qMin(writeSize, static_cast<qint64>(raw.size()) - rawOffset);
-                if (writeSize <= 0) break;
-
-                outFile.seek(writeOffset);
-                outFile.write(rawPtr + rawOffset, writeSize);
-                rawOffset += writeSize;
-            }
-            break;
-        }
-        case PayloadOpType::Zero: {
-            // Write zeros to destination extents
-            for (const auto& ext : op.dstExtents) {
-                qint64 writeOffset = static_cast<qint64>(ext.startBlock) * m_blockSize;
-                qint64 writeSize   = static_cast<qint64>(ext.numBlocks) * m_blockSize;
-                outFile.seek(writeOffset);
-                QByteArray zeros(static_cast<int>(qMin<qint64>(writeSize, 1024 * 1024)), '\0');
-                qint64 remaining = writeSize;
-                while (remaining > 0) {
-                    qint64 toWrite = qMin<qint64>(remaining, zeros.size());
-                    outFile.write(zeros.constData(), toWrite);
-                    remaining -= toWrite;
-                }
-            }
-            break;
-        }
-        default:
-            // SourceCopy, Bsdiff, etc. require a source partition – skip for now
-            LOG_WARNING_CAT(TAG, QStringLiteral("Unsupported op type %1 in partition %2")
-                                     .arg(static_cast<int>(op.type)).arg(name));
-            break;
+    for (const auto& op : part->operations) {
+        if (!decodeOperation(*part, op, opSink))
+            return false;
+        // Nothing is read back on the streaming path, so a hash that can
+        // no longer be computed must stop the walk rather than pass
+        if (hasher && hasher->overflowed()) {
+            LOG_ERROR_CAT(TAG, QStringLiteral("%1: extents too far out of order to verify "
+                                              "the partition hash")
+                                   .arg(name));
+            return false;
         }
 
         ++completedOps;
@@ -428,8 +481,319 @@ bool PayloadParser::extractPartition(const QString& name, const QString& outPath
             progress(completedOps, totalOps);
     }
 
-    outFile.close();
-    LOG_INFO_CAT(TAG, QStringLiteral("Extracted %1 -> %2").arg(name, outPath));
+    if (hasher && !hasher->finish())
+        return false;
+    return true;
+}
+
+bool PayloadParser::decodeOperation(const PayloadPartition& part, const PayloadOperation& op,
+                                    const ExtentCallback& sink, bool* hashMismatch) const
+{
+    // Hashed on the calling (worker) thread, so verification runs in
+    // parallel with the other operations' decoding and writes
+    auto checkData = [&](const QByteArray& blob) {
+        if (!m_verifyHashes || op.dataHash.isEmpty()
+            || QCryptographicHash::hash(blob, QCryptographicHash::Sha256) == op.dataHash)
+            return true;
+        LOG_ERROR_CAT(TAG, QStringLiteral("%1: operation %2 data hash mismatch")
+                               .arg(part.name).arg(&op - part.operations.data()));
+        if (hashMismatch)
+            *hashMismatch = true;
+        return false;
+    };
+
+    qint64 dstSize = 0;
+    for (const auto& ext : op.dstExtents)
+        dstSize += static_cast<qint64>(ext.numBlocks) * m_blockSize;
+
+    switch (op.type) {
+    case PayloadOpType::Replace:
+    case PayloadOpType::ReplaceBz:
+    case PayloadOpType::ReplaceXz:
+    case PayloadOpType::ReplaceZstd: {
+        QByteArray compressed = readOperationData(op.dataOffset, op.dataLength);
+        if (compressed.isEmpty() && op.dataLength > 0) {
+            LOG_ERROR_CAT(TAG, "Failed to read operation data");
+            return false;
+        }
+        if (!checkData(compressed))
+            return false;
+        QByteArray raw = decompressData(compressed, op.type, dstSize);
+        if (raw.isEmpty() && op.dataLength > 0) {
+            LOG_ERROR_CAT(TAG, "Decompression failed");
+            return false;
+        }
+        // REPLACE data is still a view into the mapped payload
+        return emitExtents(op, raw, sink, op.type == PayloadOpType::Replace && m_map);
+    }
+    case PayloadOpType::Zero:
+    case PayloadOpType::Discard: {
+        for (const auto& ext : op.dstExtents) {
+            PayloadExtentData out;
+            out.kind = op.type == PayloadOpType::Zero ? PayloadExtentData::Kind::Zero
+                                                      : PayloadExtentData::Kind::Discard;
+            out.startBlock = ext.startBlock;
+            out.numBlocks  = ext.numBlocks;
+            if (!sink(out))
+                return false;
+        }
+        return true;
+    }
+    case PayloadOpType::SourceCopy: {
+        QByteArray src;
+        if (!readSourceExtents(part, op, src))
+            return false;
+        return emitExtents(op, src, sink);
+    }
+    case PayloadOpType::SourceBsdiff:
+    case PayloadOpType::BrotliBsdiff: {
+        QByteArray src;
+        if (!readSourceExtents(part, op, src))
+            return false;
+        QByteArray patch = readOperationData(op.dataOffset, op.dataLength);
+        if (patch.size() != static_cast<qint64>(op.dataLength)) {
+            LOG_ERROR_CAT(TAG, "Failed to read patch data");
+            return false;
+        }
+        if (!checkData(patch))
+            return false;
+        QByteArray raw;
+        if (!BsPatch::apply(src, patch, raw)) {
+            LOG_ERROR_CAT(TAG, QStringLiteral("%1: bsdiff patch failed").arg(part.name));
+            return false;
+        }
+        if (raw.size() < dstSize) {
+            LOG_ERROR_CAT(TAG, QStringLiteral("%1: patched data short (%2 of %3 bytes)")
+                                   .arg(part.name).arg(raw.size()).arg(dstSize));
+            return false;
+        }
+        return emitExtents(op, raw, sink);
+    }
+    default:
+        // MOVE/BSDIFF are in-place (only valid against the live device),
+        // puffdiff, zucchini and lz4diff need their own patch engines.
+        // Failing here beats writing a partition with holes in it.
+        LOG_ERROR_CAT(TAG, QStringLiteral("%1: unsupported op type %2")
+                               .arg(part.name).arg(static_cast<int>(op.type)));
+        return false;
+    }
+}
+
+bool PayloadParser::emitExtents(const PayloadOperation& op, const QByteArray& raw,
+                                const ExtentCallback& sink, bool borrowed) const
+{
+    // Split across destination extents; a single extent takes the buffer
+    // as is, and slices of a mapped buffer are views as well
+    qint64 rawOffset = 0;
+    for (const auto& ext : op.dstExtents) {
+        qint64 writeSize = static_cast<qint64>(ext.numBlocks) * m_blockSize;
+        writeSize = qMin(writeSize, static_cast<qint64>(raw.size()) - rawOffset);
+        if (writeSize <= 0) break;
+
+        PayloadExtentData out;
+        out.startBlock = ext.startBlock;
+        out.numBlocks  = ext.numBlocks;
+        if (rawOffset == 0 && writeSize == raw.size())
+            out.data = raw;
+        else if (borrowed)
+            out.data = QByteArray::fromRawData(raw.constData() + rawOffset, writeSize);
+        else
+            out.data = raw.mid(rawOffset, writeSize);
+        if (!sink(out))
+            return false;
+        rawOffset += writeSize;
+    }
+    return true;
+}
+
+// ---------------------------------------------------------------------------
+// Source partitions (incremental payloads)
+// ---------------------------------------------------------------------------
+
+void PayloadParser::setSourceReader(const QString& partition, SourceReader reader)
+{
+    if (reader)
+        m_sources.insert(partition, std::move(reader));
+    else
+        m_sources.remove(partition);
+}
+
+bool PayloadParser::setSourceFile(const QString& partition, const QString& path)
+{
+    auto file = std::make_unique<QFile>(path);
+    if (!file->open(QIODevice::ReadOnly)) {
+        LOG_ERROR_CAT(TAG, QStringLiteral("Cannot open source image %1: %2")
+                               .arg(path, file->errorString()));
+        return false;
+    }
+    QFile* f = file.get();
+    m_sourceFiles.push_back(std::move(file));
+    setSourceReader(partition, [f](qint64 offset, char* dst, qint64 size) {
+        return FileIo::readAt(*f, offset, dst, size) == size;
+    });
+    return true;
+}
+
+bool PayloadParser::needsSource(const PayloadPartition& part)
+{
+    for (const auto& op : part.operations) {
+        if (!op.srcExtents.empty())
+            return true;
+    }
+    return false;
+}
+
+bool PayloadParser::readSourceExtents(const PayloadPartition& part, const PayloadOperation& op,
+                                      QByteArray& out) const
+{
+    auto it = m_sources.constFind(part.name);
+    if (it == m_sources.constEnd()) {
+        LOG_ERROR_CAT(TAG, QStringLiteral("%1: incremental payload needs the source partition")
+                               .arg(part.name));
+        return false;
+    }
+
+    qint64 total = 0;
+    for (const auto& ext : op.srcExtents)
+        total += static_cast<qint64>(ext.numBlocks) * m_blockSize;
+
+    out.resize(total);
+    qint64 pos = 0;
+    for (const auto& ext : op.srcExtents) {
+        qint64 len = static_cast<qint64>(ext.numBlocks) * m_blockSize;
+        if (!(*it)(static_cast<qint64>(ext.startBlock) * m_blockSize, out.data() + pos, len)) {
+            LOG_ERROR_CAT(TAG, QStringLiteral("%1: failed to read source blocks %2+%3")
+                                   .arg(part.name).arg(ext.startBlock).arg(ext.numBlocks));
+            return false;
+        }
+        pos += len;
+    }
+
+    // A wrong source image would otherwise patch into silent garbage
+    if (!op.srcHash.isEmpty()
+        && QCryptographicHash::hash(out, QCryptographicHash::Sha256) != op.srcHash) {
+        LOG_ERROR_CAT(TAG, QStringLiteral("%1: source hash mismatch, wrong source build?")
+                               .arg(part.name));
+        return false;
+    }
+    return true;
+}
+
+// ---------------------------------------------------------------------------
+// PayloadPartitionHasher
+// ---------------------------------------------------------------------------
+
+PayloadPartitionHasher::PayloadPartitionHasher(const PayloadPartition& part, uint32_t blockSize,
+                                               uint64_t totalBlocks, qint64 maxPending)
+    : m_part(part)
+    , m_blockSize(blockSize)
+    , m_totalBlocks(totalBlocks)
+    , m_maxPending(maxPending)
+    , m_hash(QCryptographicHash::Sha256)
+{
+    m_limit = part.size > 0 ? static_cast<qint64>(part.size)
+                            : static_cast<qint64>(totalBlocks) * blockSize;
+    for (const auto& op : part.operations)
+        for (const auto& ext : op.dstExtents)
+            m_starts.push_back(ext.startBlock);
+    std::sort(m_starts.begin(), m_starts.end());
+    m_starts.erase(std::unique(m_starts.begin(), m_starts.end()), m_starts.end());
+}
+
+void PayloadPartitionHasher::add(const PayloadExtentData& extent)
+{
+    QMutexLocker lock(&m_mutex);
+    if (m_overflowed)
+        return;
+
+    const qint64 bytes = extent.kind == PayloadExtentData::Kind::Data ? extent.data.size() : 0;
+    if (extent.startBlock < m_nextBlock || m_pendingBytes + bytes > m_maxPending) {
+        // Rewritten blocks or too much held back: give up on this pass
+        m_overflowed = true;
+        m_pending.clear();
+        m_pendingBytes = 0;
+        return;
+    }
+    m_pending.emplace(extent.startBlock, extent);
+    m_pendingBytes += bytes;
+    drain();
+}
+
+void PayloadPartitionHasher::drain()
+{
+    while (m_nextBlock < m_totalBlocks) {
+        auto it = m_pending.begin();
+        if (it != m_pending.end() && it->first == m_nextBlock) {
+            if (it->second.kind == PayloadExtentData::Kind::Data)
+                m_pendingBytes -= it->second.data.size();
+            hashExtent(it->second);
+            m_nextBlock += it->second.numBlocks;
+            m_pending.erase(it);
+            continue;
+        }
+
+        // Blocks no operation writes read back as zeros
+        auto next = std::lower_bound(m_starts.begin(), m_starts.end(), m_nextBlock);
+        if (next != m_starts.end() && *next == m_nextBlock)
+            return;     // the extent starting here has not arrived yet
+        const uint64_t holeEnd = next == m_starts.end() ? m_totalBlocks : *next;
+        hashZeros(static_cast<qint64>(holeEnd - m_nextBlock) * m_blockSize);
+        m_nextBlock = holeEnd;
+    }
+}
+
+void PayloadPartitionHasher::feed(const char* data, qint64 size)
+{
+    size = qMin(size, m_limit - m_hashed);
+    if (size <= 0)
+        return;
+    m_hash.addData(QByteArrayView(data, size));
+    m_hashed += size;
+}
+
+void PayloadPartitionHasher::hashExtent(const PayloadExtentData& extent)
+{
+    const qint64 bytes = static_cast<qint64>(extent.numBlocks) * m_blockSize;
+    qint64 data = 0;
+    if (extent.kind == PayloadExtentData::Kind::Data) {
+        data = qMin<qint64>(extent.data.size(), bytes);
+        feed(extent.data.constData(), data);
+    }
+    hashZeros(bytes - data);
+}
+
+void PayloadPartitionHasher::hashZeros(qint64 bytes)
+{
+    static const QByteArray zeros(1 << 20, '\0');
+    while (bytes > 0) {
+        const qint64 n = qMin<qint64>(bytes, zeros.size());
+        feed(zeros.constData(), n);
+        bytes -= n;
+    }
+}
+
+bool PayloadPartitionHasher::finish()
+{
+    QMutexLocker lock(&m_mutex);
+
+    // Whatever is still held (e.g. after a failed operation) is hashed in
+    // block order with zeros in the gaps
+    for (auto& [start, extent] : m_pending) {
+        if (start > m_nextBlock)
+            hashZeros(static_cast<qint64>(start - m_nextBlock) * m_blockSize);
+        hashExtent(extent);
+        m_nextBlock = qMax(m_nextBlock, start + extent.numBlocks);
+    }
+    m_pending.clear();
+    hashZeros(m_limit - m_hashed);
+
+    if (m_part.hash.isEmpty())
+        return true;
+    if (m_hash.result() != m_part.hash) {
+        LOG_ERROR_CAT(TAG, QStringLiteral("%1: partition hash mismatch").arg(m_part.name));
+        return false;
+    }
+    LOG_INFO_CAT(TAG, QStringLiteral("%1: partition hash verified").arg(m_part.name));
     return true;
 }
 
@@ -437,23 +801,35 @@ bool PayloadParser::extractPartition(const QString& name, const QString& outPath
 // readOperationData
 // ---------------------------------------------------------------------------
 
-QByteArray PayloadParser::readOperationData(uint64_t offset, uint64_t length)
+QByteArray PayloadParser::readOperationData(uint64_t offset, uint64_t length) const
 {
     if (!m_file || !m_file->isOpen())
         return {};
 
-    qint64 absOffset = static_cast<qint64>(m_dataOffset + offset);
-    if (!m_file->seek(absOffset))
-        return {};
+    // Mapped: a view into the payload, no copy.  Views stay valid for the
+    // parser's lifetime, so sinks may hold on to them.
+    if (m_map) {
+        uint64_t begin = m_dataOffset + offset;
+        if (begin + length > static_cast<uint64_t>(m_payloadSize))
+            return {};
+        return QByteArray::fromRawData(reinterpret_cast<const char*>(m_map + begin),
+                                       static_cast<qsizetype>(length));
+    }
 
-    return m_file->read(static_cast<qint64>(length));
+    QByteArray data(static_cast<qint64>(length), Qt::Uninitialized);
+    qint64 got = FileIo::readAt(*m_file, m_base + static_cast<qint64>(m_dataOffset + offset),
+                                data.data(), data.size());
+    if (got != data.size())
+        return {};
+    return data;
 }
 
 // ---------------------------------------------------------------------------
 // decompressData – handle various compression types
 // ---------------------------------------------------------------------------
 
-QByteArray PayloadParser::decompressData(const QByteArray& compressed, PayloadOpType type)
+QByteArray PayloadParser::decompressData(const QByteArray& compressed, PayloadOpType type,
+                                         qint64 expectedSize) const
 {
     switch (type) {
     case PayloadOpType::Replace:
@@ -461,18 +837,12 @@ QByteArray PayloadParser::decompressData(const QByteArray& compressed, PayloadOp
         return compressed;
 
     case PayloadOpType::ReplaceBz: {
-        // bzip2 decompression — we implement a minimal BZ2 decoder
-        // BZ2 header: 'B','Z','h' followed by block size digit ('1'-'9')
-        if (compressed.size() < 10 || compressed[0] != 'B' || compressed[1] != 'Z') {
-            LOG_ERROR_CAT(TAG, "Invalid bzip2 header");
+        QByteArray result = Bzip2Decoder::decompress(compressed, expectedSize);
+        if (result.isEmpty()) {
+            LOG_ERROR_CAT(TAG, "bzip2 decompression failed");
             return {};
         }
-        // bzip2 uses Burrows-Wheeler transform + Huffman coding.
-        // Without libbz2, we cannot decompress. Return the raw data
-        // and log a clear warning.
-        LOG_WARNING_CAT(TAG, QStringLiteral("bzip2 data: %1 bytes (libbz2 not linked, data returned as-is)")
-                                .arg(compressed.size()));
-        return compressed;
+        return result;
     }
 
     case PayloadOpType::ReplaceXz: {
@@ -489,29 +859,19 @@ QByteArray PayloadParser::decompressData(const QByteArray& compressed, PayloadOp
         return result;
     }
 
-    case PayloadOpType::Brotli: {
-        // Brotli compressed data — no libbrotli available
-        // Brotli is used by some newer Android OTA payloads.
-        // Without the library, we return the compressed data as-is.
-        LOG_WARNING_CAT(TAG, QStringLiteral("Brotli data: %1 bytes (libbrotli not linked, data returned as-is)")
-                                .arg(compressed.size()));
-        return compressed;
+    case PayloadOpType::ReplaceZstd: {
+        QByteArray result = ZstdDecoder::decompress(compressed, expectedSize);
+        if (result.isEmpty()) {
+            LOG_ERROR_CAT(TAG, "zstd decompression failed");
+            return {};
+        }
+        return result;
     }
 
-    case PayloadOpType::Zero:
-    case PayloadOpType::Discard:
-        // These don't carry data payloads
-        return {};
-
-    case PayloadOpType::SourceCopy:
-    case PayloadOpType::Move:
-        // Source-based operations: data comes from source partition, not payload
-        return compressed;
-
     default:
-        LOG_WARNING_CAT(TAG, QString("Unknown compression type %1, returning raw data")
-                                 .arg(static_cast<int>(type)));
-        return compressed;
+        LOG_ERROR_CAT(TAG, QString("Op type %1 carries no compressed replacement data")
+                               .arg(static_cast<int>(type)));
+        return {};
     }
 }
 
@@ -1,11 +1,15 @@
 #pragma once
 
 #include <QByteArray>
+#include <QCryptographicHash>
 #include <QFile>
+#include <QHash>
+#include <QMutex>
 #include <QString>
 #include <QStringList>
 #include <cstdint>
 #include <functional>
+#include <map>
 #include <memory>
 #include <vector>
 
@@ -27,19 +31,21 @@ namespace sakura {
 // --- Operation types -------------------------------------------------------
 
 enum class PayloadOpType : uint32_t {
-    Replace     = 0,   // Raw data replacement
-    ReplaceBz   = 1,   // bzip2-compressed replacement
-    Move        = 2,   // Block-level move (source → target)
-    Bsdiff      = 3,   // Binary diff (source → target)
-    SourceCopy  = 4,   // Copy from source partition
-    SourceBsdiff= 5,   // Bsdiff from source partition
-    ReplaceXz   = 8,   // xz-compressed replacement
-    Zero        = 6,   // Fill with zeros
-    Discard     = 7,   // Mark extents as unused
-    Puffdiff    = 9,   // Puffdiff (deflate-aware)
-    Brotli      = 10,  // Brotli-compressed replacement
-    Zucchini    = 11,  // Zucchini diff
-    LZ4diff     = 12,  // LZ4-diff
+    Replace         = 0,   // Raw data replacement
+    ReplaceBz       = 1,   // bzip2-compressed replacement
+    Move            = 2,   // Block-level move (source → target)
+    Bsdiff          = 3,   // Binary diff (source → target)
+    SourceCopy      = 4,   // Copy from source partition
+    SourceBsdiff    = 5,   // Bsdiff from source partition
+    ReplaceXz       = 8,   // xz-compressed replacement
+    Zero            = 6,   // Fill with zeros
+    Discard         = 7,   // Mark extents as unused
+    Puffdiff        = 9,   // Puffdiff (deflate-aware)
+    BrotliBsdiff    = 10,  // Bsdiff with Brotli-compressed streams
+    Zucchini        = 11,  // Zucchini diff
+    LZ4diffBsdiff   = 12,  // Bsdiff over LZ4-recompressed blocks
+    LZ4diffPuffdiff = 13,  // Puffdiff over LZ4-recompressed blocks
+    ReplaceZstd     = 14,  // zstd-compressed replacement
 };
 
 // --- Data extent -----------------------------------------------------------
@@ -70,6 +76,62 @@ struct PayloadPartition {
     QByteArray                     hash;           // expected hash
 };
 
+// --- Reconstructed destination extent --------------------------------------
+
+struct PayloadExtentData {
+    enum class Kind { Data, Zero, Discard };
+
+    Kind       kind       = Kind::Data;
+    uint64_t   startBlock = 0;
+    uint64_t   numBlocks  = 0;
+    QByteArray data;       // Kind::Data only; may end short of numBlocks
+};
+
+// ---------------------------------------------------------------------------
+// PayloadPartitionHasher
+//
+// SHA-256 of the reconstructed partition, fed with extents as they are
+// produced.  Extents arriving ahead of the hash position are held until the
+// gap before them is filled; block ranges no operation writes are hashed as
+// zeros.  If more than @p maxPending bytes would have to be held, the
+// hasher gives up (overflowed()) and the caller falls back to hashing the
+// output.  add() is thread-safe.
+// ---------------------------------------------------------------------------
+
+class PayloadPartitionHasher {
+public:
+    PayloadPartitionHasher(const PayloadPartition& part, uint32_t blockSize,
+                           uint64_t totalBlocks, qint64 maxPending);
+
+    void add(const PayloadExtentData& extent);
+
+    bool overflowed() const { return m_overflowed; }
+
+    /// Hash the remaining blocks and compare with the manifest hash.
+    /// Returns true when they match or the manifest records no hash.
+    bool finish();
+
+private:
+    void drain();
+    void feed(const char* data, qint64 size);
+    void hashExtent(const PayloadExtentData& extent);
+    void hashZeros(qint64 bytes);
+
+    const PayloadPartition&         m_part;
+    uint32_t                        m_blockSize;
+    uint64_t                        m_totalBlocks;
+    qint64                          m_maxPending;
+    qint64                          m_pendingBytes = 0;
+    qint64                          m_limit        = 0;   // partition size in bytes
+    qint64                          m_hashed       = 0;   // bytes fed so far
+    uint64_t                        m_nextBlock    = 0;
+    bool                            m_overflowed   = false;
+    std::vector<uint64_t>           m_starts;             // sorted extent starts
+    std::map<uint64_t, PayloadExtentData> m_pending;
+    QCryptographicHash              m_hash;
+    QMutex                          m_mutex;
+};
+
 // ---------------------------------------------------------------------------
 // PayloadParser
 // ---------------------------------------------------------------------------
@@ -77,12 +139,17 @@ struct PayloadPartition {
 class PayloadParser {
 public:
     using ProgressCallback = std::function<void(qint64 current, qint64 total)>;
+    using ExtentCallback   = std::function<bool(const PayloadExtentData& extent)>;
+    /// Positioned read of @p size bytes at byte @p offset of a source
+    /// partition.  Called from worker threads, so it must be reentrant.
+    using SourceReader     = std::function<bool(qint64 offset, char* dst, qint64 size)>;
 
     PayloadParser();
     ~PayloadParser();
 
-    /// Load a payload.bin file.  Returns true if the header + manifest
-    /// were successfully parsed.
+    /// Load a payload.bin file, or an OTA zip holding a STORED payload.bin
+    /// (read in place, nothing is extracted).  Returns true if the header
+    /// + manifest were successfully parsed.
     bool load(const QString& path);
 
     /// Whether a payload is currently loaded.
@@ -107,17 +174,70 @@ public:
     bool extractPartition(const QString& name, const QString& outPath,
                           ProgressCallback progress = nullptr);
 
+    /// Reconstruct a partition operation by operation and hand every
+    /// destination extent to @p sink, in payload order, without touching
+    /// the disk.  Returning false from the sink aborts the walk.  With
+    /// verification on, the walk also fails if the partition hash cannot
+    /// be checked (extents too far out of order to hash in memory).
+    bool streamPartition(const QString& name, const ExtentCallback& sink,
+                         ProgressCallback progress = nullptr);
+
+    /// Decode one operation of @p part and hand its destination extents to
+    /// @p sink.  Thread-safe: every operation only reads the payload and the
+    /// source partition, so full OTAs and incremental OTAs (whose sources
+    /// are never written) may be decoded concurrently.  With verification
+    /// on, the operation data is hashed here, on the decoding thread;
+    /// a mismatch sets @p hashMismatch and fails the operation.
+    bool decodeOperation(const PayloadPartition& part, const PayloadOperation& op,
+                         const ExtentCallback& sink, bool* hashMismatch = nullptr) const;
+
+    /// Check operation data and partition SHA-256 hashes while decoding.
+    void setVerifyHashes(bool verify) { m_verifyHashes = verify; }
+    bool verifyHashes() const         { return m_verifyHashes; }
+
+    /// Source partition contents for incremental payloads (SOURCE_COPY and
+    /// the bsdiff family).  A reader can be backed by a device readback;
+    /// setSourceFile() is the common case of a dumped image.
+    void setSourceReader(const QString& partition, SourceReader reader);
+    bool setSourceFile(const QString& partition, const QString& path);
+    bool hasSource(const QString& partition) const { return m_sources.contains(partition); }
+
+    /// True if any operation of @p part needs the source partition.
+    static bool needsSource(const PayloadPartition& part);
+
+    /// Size of the reconstructed partition in blocks (from the manifest, or
+    /// the furthest destination extent when the size is not recorded).
+    uint64_t partitionBlocks(const PayloadPartition& part) const;
+
 private:
     bool parseHeader();
     bool parseManifest(const QByteArray& manifestData);
 
-    /// Read raw operation data from the payload file.
-    QByteArray readOperationData(uint64_t offset, uint64_t length);
+    /// Operation data from the payload file: a zero-copy view into the
+    /// mapping, or a positioned read when the file is not mapped.  Safe to
+    /// call from several threads either way.
+    QByteArray readOperationData(uint64_t offset, uint64_t length) const;
 
     /// Decompress operation data according to the operation type.
-    QByteArray decompressData(const QByteArray& compressed, PayloadOpType type);
+    /// @p expectedSize is the destination size, used to size the output.
+    QByteArray decompressData(const QByteArray& compressed, PayloadOpType type,
+                              qint64 expectedSize = -1) const;
+
+    /// Gather the source extents of @p op into @p out and check them
+    /// against the operation's source hash.
+    bool readSourceExtents(const PayloadPartition& part, const PayloadOperation& op,
+                           QByteArray& out) const;
+
+    /// Hand @p raw to @p sink split across the destination extents.
+    /// @p borrowed marks @p raw as a view into the mapping, so the
+    /// per-extent slices can be views too.
+    bool emitExtents(const PayloadOperation& op, const QByteArray& raw,
+                     const ExtentCallback& sink, bool borrowed = false) const;
 
     std::unique_ptr<QFile>          m_file;
+    qint64                          m_base          = 0; // payload offset in the file (zip)
+    qint64                          m_payloadSize   = 0;
+    uchar*                          m_map           = nullptr;
     bool                            m_loaded        = false;
     uint64_t                        m_formatVersion = 0;
     uint64_t                        m_manifestSize  = 0;
@@ -125,6 +245,9 @@ private:
     uint64_t                        m_dataOffset    = 0; // offset to first data blob
     uint32_t                        m_blockSize     = 4096;
     std::vector<PayloadPartition>   m_partitions;
+    bool                            m_verifyHashes  = false;
+    QHash<QString, SourceReader>    m_sources;
+    std::vector<std::unique_ptr<QFile>> m_sourceFiles;
 };
 
 } // namespace sakura
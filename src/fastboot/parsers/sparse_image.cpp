@@ -3,12 +3,17 @@
 
 #include <QDataStream>
 #include <QtEndian>
+#include <cstddef>
 #include <cstring>
 
 namespace sakura {
 
 static constexpr const char* TAG = "SparseImage";
 
+// RAW data examined per step when looking for uniform blocks, and the size
+// of the read-ahead window used when the source is not mapped
+static constexpr qint64 UNIFORM_SCAN_WINDOW = 4 * 1024 * 1024;
+
 // ---------------------------------------------------------------------------
 // isSparse
 // ---------------------------------------------------------------------------
@@ -48,115 +53,434 @@ std::vector<QByteArray> SparseImage::splitForTransfer(const QByteArray& sparseDa
         return result;
     }
 
-    // Parse the sparse header
-    SparseHeader hdr;
-    std::memcpy(&hdr, sparseData.constData(), sizeof(SparseHeader));
+    SparseStream image;
+    if (!image.open(sparseData))
+        return result;
 
-    // Walk chunks and assign them into buckets that fit maxDownloadSize
-    int offset = hdr.fileHeaderSize;
-    std::vector<int>      currentChunkIndices;
-    std::vector<std::pair<int, int>> chunkOffsets; // (offset, total_size) per chunk
-    uint32_t currentSize = sizeof(SparseHeader);
-    uint32_t currentBlocks = 0;
+    result = collectSegments(image, maxDownloadSize);
+    LOG_INFO_CAT(TAG, QStringLiteral("Split sparse image into %1 chunk(s)")
+                          .arg(result.size()));
+    return result;
+}
 
-    for (uint32_t i = 0; i < hdr.totalChunks; ++i) {
-        if (offset + static_cast<int>(sizeof(SparseChunkHeader)) > sparseData.size())
-            break;
+// ---------------------------------------------------------------------------
+// rawToTransferChunks
+// ---------------------------------------------------------------------------
+
+std::vector<QByteArray> SparseImage::rawToTransferChunks(const QByteArray& rawData,
+                                                          uint32_t maxDownloadSize,
+                                                          bool zeroAsDontCare)
+{
+    // Uniform blocks become FILL (or DONT_CARE) chunks and never hit the wire
+    SparseStream image;
+    if (!image.open(rawData))
+        return {};
+    return collectSegments(image, maxDownloadSize, true, zeroAsDontCare);
+}
 
-        SparseChunkHeader chHdr;
-        std::memcpy(&chHdr, sparseData.constData() + offset, sizeof(SparseChunkHeader));
+// ---------------------------------------------------------------------------
+// collectSegments – materialise every segment of an open image
+// ---------------------------------------------------------------------------
+
+std::vector<QByteArray> SparseImage::collectSegments(SparseStream& image,
+                                                      uint32_t maxDownloadSize,
+                                                      bool fillUniform, bool zeroAsDontCare)
+{
+    std::vector<QByteArray> result;
+    SparseSegmenter segmenter(image, maxDownloadSize);
+    segmenter.setFillUniformBlocks(fillUniform, zeroAsDontCare);
+    QList<QByteArray> parts;
+    while (segmenter.hasNext()) {
+        if (!segmenter.next(parts))
+            return {};
+
+        qint64 size = 0;
+        for (const QByteArray& part : parts)
+            size += part.size();
+
+        QByteArray segment;
+        segment.reserve(size);
+        for (const QByteArray& part : parts)
+            segment.append(part);
+        result.push_back(std::move(segment));
+    }
+    return result;
+}
 
-        chunkOffsets.push_back({offset, static_cast<int>(chHdr.totalSize)});
+// ---------------------------------------------------------------------------
+// SparseSegmenter
+// ---------------------------------------------------------------------------
 
-        uint32_t chunkTotalSize = chHdr.totalSize;
+SparseSegmenter::SparseSegmenter(SparseStream& image, uint32_t maxDownloadSize)
+    : m_image(image)
+    , m_maxDownloadSize(maxDownloadSize)
+{
+    if (image.isSparseImage())
+        m_blockSize = image.blockSize();
+    m_totalBlocks = static_cast<uint32_t>((image.rawSize() + m_blockSize - 1) / m_blockSize);
+}
 
-        // Would adding this chunk exceed the limit?
-        if (!currentChunkIndices.empty() &&
-            (currentSize + chunkTotalSize) > maxDownloadSize) {
-            // Flush current bucket
-            result.push_back(buildSparseFromChunks(sparseData, hdr,
-                                                    currentChunkIndices, currentBlocks));
-            currentChunkIndices.clear();
-            currentSize = sizeof(SparseHeader);
-            currentBlocks = 0;
-        }
+bool SparseSegmenter::hasNext() const
+{
+    return m_chunk < m_image.chunks().size();
+}
 
-        currentChunkIndices.push_back(static_cast<int>(i));
-        currentSize   += chunkTotalSize;
-        currentBlocks += chHdr.chunkBlocks;
+qint64 SparseSegmenter::chunkBlocks(size_t index) const
+{
+    // Plain images are a single RAW chunk whose last block may be partial
+    return (m_image.chunks()[index].rawSize + m_blockSize - 1) / m_blockSize;
+}
 
-        offset += static_cast<int>(chunkTotalSize);
+bool SparseSegmenter::next(QList<QByteArray>& parts)
+{
+    parts.clear();
+    if (!hasNext())
+        return false;
+
+    constexpr qint64 chunkHdrSize = sizeof(SparseChunkHeader);
+
+    // Reserve room for the file header and the leading/trailing skip chunks
+    const qint64 budget = static_cast<qint64>(m_maxDownloadSize)
+                          - static_cast<qint64>(sizeof(SparseHeader)) - 2 * chunkHdrSize;
+    if (budget < chunkHdrSize + m_blockSize) {
+        LOG_ERROR_CAT(TAG, QStringLiteral("max-download-size 0x%1 cannot hold a %2-byte block")
+                               .arg(m_maxDownloadSize, 0, 16).arg(m_blockSize));
+        return false;
     }
 
-    // Flush remaining
-    if (!currentChunkIndices.empty()) {
-        result.push_back(buildSparseFromChunks(sparseData, hdr,
-                                                currentChunkIndices, currentBlocks));
+    QByteArray pending;     // generated headers not yet moved into parts
+    uint32_t chunkCount = 0;
+    qint64 used = 0;
+
+    auto addChunk = [&](uint16_t type, qint64 blocks, qint64 dataSize) {
+        SparseChunkHeader chdr{};
+        chdr.chunkType   = type;
+        chdr.chunkBlocks = static_cast<uint32_t>(blocks);
+        chdr.totalSize   = static_cast<uint32_t>(chunkHdrSize + dataSize);
+        pending.append(reinterpret_cast<const char*>(&chdr), sizeof(chdr));
+        ++chunkCount;
+    };
+
+    SparseHeader hdr{};
+    hdr.magic           = SPARSE_HEADER_MAGIC;
+    hdr.majorVersion    = 1;
+    hdr.minorVersion    = 0;
+    hdr.fileHeaderSize  = sizeof(SparseHeader);
+    hdr.chunkHeaderSize = sizeof(SparseChunkHeader);
+    hdr.blockSize       = m_blockSize;
+    hdr.totalBlocks     = m_totalBlocks;
+    pending.append(reinterpret_cast<const char*>(&hdr), sizeof(hdr));
+
+    if (m_blockPos > 0)
+        addChunk(CHUNK_TYPE_DONT_CARE, m_blockPos, 0);
+
+    const auto& chunks = m_image.chunks();
+    while (m_chunk < chunks.size()) {
+        const auto& chunk = chunks[m_chunk];
+        const qint64 remaining = chunkBlocks(m_chunk) - m_chunkBlockPos;
+        qint64 take = remaining;
+
+        if (chunk.type == CHUNK_TYPE_RAW) {
+            const qint64 rawPos = m_chunkBlockPos * m_blockSize;
+            take = qMin(remaining, (budget - used - chunkHdrSize) / m_blockSize);
+
+            const uchar* base = nullptr;
+            qint64 fillRun = 0;
+            if (m_fillUniform) {
+                if (take <= 0 && used + chunkHdrSize + 4 > budget)
+                    break;
+
+                qint64 windowBytes = qMin(qMax<qint64>(1, UNIFORM_SCAN_WINDOW / m_blockSize) * m_blockSize,
+                                          chunk.rawSize - rawPos);
+                base = scanWindow(chunk, rawPos, windowBytes);
+                if (!base) {
+                    LOG_ERROR_CAT(TAG, QStringLiteral("Failed to read %1 bytes at 0x%2")
+                                           .arg(windowBytes).arg(chunk.dataOffset + rawPos, 0, 16));
+                    return false;
+                }
+
+                const qint64 window = (windowBytes + m_blockSize - 1) / m_blockSize;
+                const qint64 fullBlocks = windowBytes / m_blockSize;
+                auto uniformAt = [&](qint64 b) {
+                    return b < fullBlocks
+                        && SparseStream::isUniformBlock(base + b * m_blockSize, m_blockSize);
+                };
+
+                if (uniformAt(0)) {
+                    // Blocks equal to a uniform first block share its value
+                    fillRun = 1;
+                    while (fillRun < fullBlocks
+                           && std::memcmp(base + fillRun * m_blockSize, base, m_blockSize) == 0)
+                        ++fillRun;
+
+                    uint32_t value;
+                    std::memcpy(&value, base, 4);
+                    if (value == 0 && m_zeroAsDontCare) {
+                        if (used + chunkHdrSize > budget)
+                            break;
+                        addChunk(CHUNK_TYPE_DONT_CARE, fillRun, 0);
+                        used += chunkHdrSize;
+                    } else {
+                        if (used + chunkHdrSize + 4 > budget)
+                            break;
+                        addChunk(CHUNK_TYPE_FILL, fillRun, 4);
+                        pending.append(reinterpret_cast<const char*>(&value), 4);
+                        used += chunkHdrSize + 4;
+                    }
+                    m_filledBytes += fillRun * m_blockSize;
+                    take = fillRun;
+                } else {
+                    // Data runs up to the next uniform block in the window
+                    qint64 run = 1;
+                    while (run < qMin(take, window) && !uniformAt(run))
+                        ++run;
+                    take = qMin(take, run);
+                }
+            }
+
+            if (fillRun == 0) {
+                if (take <= 0)
+                    break;
+
+                const qint64 bytes = take * m_blockSize;
+                const qint64 avail = qMin(bytes, chunk.rawSize - rawPos);
+                // Only the emitted bytes are viewed; unmapped data is copied
+                // out of the scan window rather than read again
+                QByteArray data = (base && !m_image.chunkData(chunk))
+                    ? QByteArray(reinterpret_cast<const char*>(base), avail)
+                    : m_image.sourceView(chunk.dataOffset + rawPos, avail);
+                if (data.size() != avail) {
+                    LOG_ERROR_CAT(TAG, QStringLiteral("Failed to read %1 bytes at 0x%2")
+                                           .arg(avail).arg(chunk.dataOffset + rawPos, 0, 16));
+                    return false;
+                }
+
+                addChunk(CHUNK_TYPE_RAW, take, bytes);
+                parts.append(pending);
+                pending.clear();
+                parts.append(data);
+                if (avail < bytes)
+                    pending.append(QByteArray(bytes - avail, '\0'));
+                used += chunkHdrSize + bytes;
+            }
+        } else {
+            const qint64 cost = chunkHdrSize + (chunk.type == CHUNK_TYPE_FILL ? 4 : 0);
+            if (used + cost > budget)
+                break;
+
+            if (chunk.type == CHUNK_TYPE_FILL) {
+                addChunk(CHUNK_TYPE_FILL, take, 4);
+                pending.append(reinterpret_cast<const char*>(&chunk.fillValue), 4);
+            } else {
+                addChunk(CHUNK_TYPE_DONT_CARE, take, 0);
+            }
+            used += cost;
+        }
+
+        m_chunkBlockPos += take;
+        m_blockPos += static_cast<uint32_t>(take);
+        if (m_chunkBlockPos == chunkBlocks(m_chunk)) {
+            ++m_chunk;
+            m_chunkBlockPos = 0;
+        }
     }
 
-    LOG_INFO_CAT(TAG, QStringLiteral("Split sparse image into %1 chunk(s)")
-                          .arg(result.size()));
-    return result;
+    if (m_blockPos < m_totalBlocks)
+        addChunk(CHUNK_TYPE_DONT_CARE, m_totalBlocks - m_blockPos, 0);
+    if (!pending.isEmpty())
+        parts.append(pending);
+
+    // The file header leads the first part; fill in the final chunk count
+    std::memcpy(parts.first().data() + offsetof(SparseHeader, totalChunks),
+                &chunkCount, sizeof(chunkCount));
+
+    ++m_segments;
+    return true;
+}
+
+const uchar* SparseSegmenter::scanWindow(const SparseStream::ChunkInfo& chunk, qint64 rawPos,
+                                         qint64& len)
+{
+    if (const uchar* mapped = m_image.chunkData(chunk))
+        return mapped + rawPos;
+
+    // Serve from the cached window while it still holds a block, so every
+    // source byte is read once however the scan advances
+    const qint64 offset = chunk.dataOffset + rawPos;
+    const qint64 cached = m_windowOffset + m_window.size() - offset;
+    if (offset >= m_windowOffset && cached >= qMin<qint64>(len, m_blockSize)) {
+        len = qMin(len, cached);
+    } else {
+        m_window = m_image.sourceView(offset, len);
+        if (m_window.size() != len) {
+            m_window.clear();
+            return nullptr;
+        }
+        m_windowOffset = offset;
+    }
+    return reinterpret_cast<const uchar*>(m_window.constData()) + (offset - m_windowOffset);
 }
 
 // ---------------------------------------------------------------------------
-// rawToTransferChunks
+// SparseSegmentBuilder
 // ---------------------------------------------------------------------------
 
-std::vector<QByteArray> SparseImage::rawToTransferChunks(const QByteArray& rawData,
-                                                          uint32_t maxDownloadSize)
+SparseSegmentBuilder::SparseSegmentBuilder(uint32_t blockSize, uint32_t totalBlocks,
+                                           uint32_t maxDownloadSize, SegmentCallback onSegment)
+    : m_blockSize(blockSize)
+    , m_totalBlocks(totalBlocks)
+    // Reserve room for the file header and the leading/trailing skip chunks
+    , m_budget(static_cast<qint64>(maxDownloadSize) - static_cast<qint64>(sizeof(SparseHeader))
+               - 3 * static_cast<qint64>(sizeof(SparseChunkHeader)))
+    , m_onSegment(std::move(onSegment))
 {
-    // Convert raw data to sparse chunks via SparseStream, then split
-    auto chunks = SparseStream::rawToSparseChunks(rawData, maxDownloadSize);
+}
 
-    std::vector<QByteArray> result;
-    result.reserve(chunks.size());
-    for (auto& c : chunks)
-        result.push_back(std::move(c));
-    return result;
+bool SparseSegmentBuilder::place(uint32_t startBlock, qint64 cost)
+{
+    // Chunks inside one sparse image must be in ascending block order
+    if (!m_records.empty() && startBlock < m_nextBlock && !flush())
+        return false;
+    if (!m_records.empty() && m_used + cost > m_budget && !flush())
+        return false;
+
+    if (m_records.empty()) {
+        m_startBlock = startBlock;
+        m_nextBlock  = startBlock;
+    } else if (startBlock > m_nextBlock) {
+        Record gap;
+        gap.type   = CHUNK_TYPE_DONT_CARE;
+        gap.blocks = startBlock - m_nextBlock;
+        m_records.push_back(std::move(gap));
+        m_used += sizeof(SparseChunkHeader);
+    }
+    return true;
 }
 
-// ---------------------------------------------------------------------------
-// buildSparseFromChunks – assemble a new sparse image from selected chunks
-// ---------------------------------------------------------------------------
+bool SparseSegmentBuilder::addData(uint32_t startBlock, const QByteArray& data)
+{
+    const qint64 maxBlocks = (m_budget - 2 * static_cast<qint64>(sizeof(SparseChunkHeader)))
+                             / m_blockSize;
+    if (maxBlocks <= 0) {
+        LOG_ERROR_CAT(TAG, "max-download-size cannot hold a single block");
+        return false;
+    }
+
+    qint64 offset = 0;
+    while (offset < data.size()) {
+        // Large ranges are split so each piece fits in an empty segment
+        const qint64 blocks = qMin<qint64>((data.size() - offset + m_blockSize - 1) / m_blockSize,
+                                           maxBlocks);
+        const qint64 bytes  = blocks * m_blockSize;
+        if (!place(startBlock, static_cast<qint64>(sizeof(SparseChunkHeader)) + bytes))
+            return false;
+
+        Record rec;
+        rec.type   = CHUNK_TYPE_RAW;
+        rec.blocks = static_cast<uint32_t>(blocks);
+        if (offset == 0 && bytes == data.size()) {
+            rec.data = data;
+        } else if (offset + bytes <= data.size()) {
+            // Slice without copying; mapped payload data goes to the
+            // transport straight from the mapping
+            rec.owner = data;
+            rec.data  = QByteArray::fromRawData(data.constData() + offset, bytes);
+        } else {
+            // Partial last block is padded, which needs a copy
+            rec.data = data.mid(offset, bytes);
+            rec.data.append(QByteArray(bytes - rec.data.size(), '\0'));
+        }
+        m_records.push_back(std::move(rec));
+
+        m_used     += sizeof(SparseChunkHeader) + bytes;
+        m_nextBlock = startBlock + static_cast<uint32_t>(blocks);
+        startBlock  = m_nextBlock;
+        offset     += bytes;
+    }
+    return true;
+}
+
+bool SparseSegmentBuilder::addFill(uint32_t startBlock, uint32_t blocks, uint32_t value)
+{
+    if (blocks == 0)
+        return true;
+    if (!place(startBlock, sizeof(SparseChunkHeader) + 4))
+        return false;
+
+    Record rec;
+    rec.type   = CHUNK_TYPE_FILL;
+    rec.blocks = blocks;
+    rec.fill   = value;
+    m_records.push_back(std::move(rec));
+
+    m_used     += sizeof(SparseChunkHeader) + 4;
+    m_nextBlock = startBlock + blocks;
+    return true;
+}
 
-QByteArray SparseImage::buildSparseFromChunks(const QByteArray& original,
-                                               const SparseHeader& origHdr,
-                                               const std::vector<int>& chunkIndices,
-                                               uint32_t totalBlocks)
+bool SparseSegmentBuilder::finish()
 {
-    // Walk original to locate chunk offsets
-    std::vector<std::pair<int, int>> chunkLocations; // (offset, size)
-    int offset = origHdr.fileHeaderSize;
-    for (uint32_t i = 0; i < origHdr.totalChunks; ++i) {
-        if (offset + static_cast<int>(sizeof(SparseChunkHeader)) > original.size())
+    return m_records.empty() || flush();
+}
+
+bool SparseSegmentBuilder::flush()
+{
+    QList<QByteArray> parts;
+    QByteArray pending;
+    uint32_t chunkCount = 0;
+
+    auto addChunk = [&](uint16_t type, uint32_t blocks, uint32_t dataSize) {
+        SparseChunkHeader chdr{};
+        chdr.chunkType   = type;
+        chdr.chunkBlocks = blocks;
+        chdr.totalSize   = static_cast<uint32_t>(sizeof(SparseChunkHeader)) + dataSize;
+        pending.append(reinterpret_cast<const char*>(&chdr), sizeof(chdr));
+        ++chunkCount;
+    };
+
+    SparseHeader hdr{};
+    hdr.magic           = SPARSE_HEADER_MAGIC;
+    hdr.majorVersion    = 1;
+    hdr.minorVersion    = 0;
+    hdr.fileHeaderSize  = sizeof(SparseHeader);
+    hdr.chunkHeaderSize = sizeof(SparseChunkHeader);
+    hdr.blockSize       = m_blockSize;
+    hdr.totalBlocks     = qMax(m_totalBlocks, m_nextBlock);
+    pending.append(reinterpret_cast<const char*>(&hdr), sizeof(hdr));
+
+    if (m_startBlock > 0)
+        addChunk(CHUNK_TYPE_DONT_CARE, m_startBlock, 0);
+
+    for (const Record& rec : m_records) {
+        switch (rec.type) {
+        case CHUNK_TYPE_RAW:
+            addChunk(CHUNK_TYPE_RAW, rec.blocks, static_cast<uint32_t>(rec.data.size()));
+            parts.append(pending);
+            pending.clear();
+            parts.append(rec.data);
+            break;
+        case CHUNK_TYPE_FILL:
+            addChunk(CHUNK_TYPE_FILL, rec.blocks, 4);
+            pending.append(reinterpret_cast<const char*>(&rec.fill), 4);
             break;
-        SparseChunkHeader chHdr;
-        std::memcpy(&chHdr, original.constData() + offset, sizeof(SparseChunkHeader));
-        chunkLocations.push_back({offset, static_cast<int>(chHdr.totalSize)});
-        offset += static_cast<int>(chHdr.totalSize);
+        default:
+            addChunk(CHUNK_TYPE_DONT_CARE, rec.blocks, 0);
+            break;
+        }
     }
 
-    // Build new sparse image
-    QByteArray out;
-    out.reserve(static_cast<int>(sizeof(SparseHeader)) + 1024 * 1024);
-
-    // Write header
-    SparseHeader newHdr = origHdr;
-    newHdr.totalChunks = static_cast<uint32_t>(chunkIndices.size());
-    newHdr.totalBlocks = totalBlocks;
-    newHdr.imageCrc32  = 0; // recalculation optional
-    out.append(reinterpret_cast<const char*>(&newHdr), sizeof(SparseHeader));
-
-    // Write selected chunks
-    for (int idx : chunkIndices) {
-        if (idx < 0 || idx >= static_cast<int>(chunkLocations.size()))
-            continue;
-        auto [chOff, chSize] = chunkLocations[static_cast<size_t>(idx)];
-        out.append(original.mid(chOff, chSize));
-    }
+    if (m_nextBlock < hdr.totalBlocks)
+        addChunk(CHUNK_TYPE_DONT_CARE, hdr.totalBlocks - m_nextBlock, 0);
+    if (!pending.isEmpty())
+        parts.append(pending);
+
+    std::memcpy(parts.first().data() + offsetof(SparseHeader, totalChunks),
+                &chunkCount, sizeof(chunkCount));
 
-    return out;
+    m_records.clear();
+    m_used = 0;
+    ++m_segments;
+    return m_onSegment(parts);
 }
 
 } // namespace sakura
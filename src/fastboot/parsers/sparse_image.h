@@ -3,7 +3,9 @@
 #include "common/sparse_stream.h"
 
 #include <QByteArray>
+#include <QList>
 #include <cstdint>
+#include <functional>
 #include <vector>
 
 namespace sakura {
@@ -37,21 +39,138 @@ public:
     /// Re-sparse a raw image into transfer-sized sparse chunks.
     ///
     /// Useful when the caller has raw (non-sparse) data that must be sent via
-    /// Fastboot sparse protocol because it exceeds max-download-size.
+    /// Fastboot sparse protocol because it exceeds max-download-size.  Blocks
+    /// holding a single repeated uint32 are sent as FILL chunks; zero blocks
+    /// become DONT_CARE instead when @p zeroAsDontCare is set, which is only
+    /// safe if the partition was erased beforehand.
     static std::vector<QByteArray> rawToTransferChunks(const QByteArray& rawData,
-                                                        uint32_t maxDownloadSize);
+                                                        uint32_t maxDownloadSize,
+                                                        bool zeroAsDontCare = false);
 
     /// Get the total raw (unsparsed) image size.
     static qint64 getRawSize(const QByteArray& sparseData);
 
 private:
-    /// Build a sparse image from selected chunk indices of the original.
-    static QByteArray buildSparseFromChunks(const QByteArray& original,
-                                            const SparseHeader& hdr,
-                                            const std::vector<int>& chunkIndices,
-                                            uint32_t totalBlocks);
+    static std::vector<QByteArray> collectSegments(SparseStream& image,
+                                                   uint32_t maxDownloadSize,
+                                                   bool fillUniform = false,
+                                                   bool zeroAsDontCare = false);
 
     SparseImage() = delete;
 };
 
+// ---------------------------------------------------------------------------
+// SparseSegmenter – lazily cuts an image into max-download-size segments
+//
+// Each segment is a self-contained sparse image covering the full partition:
+// blocks before and after its own data are described by DONT_CARE chunks, so
+// the device can flash segments one after another.  Only the segment being
+// built is held in memory; RAW payloads are views into the SparseStream's
+// mapping when it has one.  Plain (non-sparse) images are wrapped as RAW.
+// ---------------------------------------------------------------------------
+
+class SparseSegmenter {
+public:
+    /// @param image            An open SparseStream; must outlive the segments.
+    /// @param maxDownloadSize  Upper bound for one segment, in bytes.
+    SparseSegmenter(SparseStream& image, uint32_t maxDownloadSize);
+
+    /// True while there is image data left to emit.
+    bool hasNext() const;
+
+    /// Build the next segment as a list of buffers to be sent back to back.
+    /// Returns false when nothing is left or the source could not be read.
+    bool next(QList<QByteArray>& parts);
+
+    /// Number of segments produced so far.
+    int segmentCount() const { return m_segments; }
+
+    /// Scan RAW data while building each segment and send blocks holding a
+    /// single repeated uint32 as FILL chunks, so no up-front pass over a
+    /// plain image is needed.  With @p zeroAsDontCare, zero blocks become
+    /// DONT_CARE instead (only safe if the partition was erased first).
+    void setFillUniformBlocks(bool enable, bool zeroAsDontCare = false)
+    {
+        m_fillUniform    = enable;
+        m_zeroAsDontCare = zeroAsDontCare;
+    }
+
+    /// Bytes sent as FILL (or skipped) instead of data so far.
+    qint64 filledBytes() const { return m_filledBytes; }
+
+private:
+    qint64 chunkBlocks(size_t index) const;
+    /// Up to @p len bytes of a RAW chunk at @p rawPos for the uniform-block
+    /// scan; @p len is trimmed to what the window holds.  nullptr on error.
+    const uchar* scanWindow(const SparseStream::ChunkInfo& chunk, qint64 rawPos, qint64& len);
+
+    SparseStream& m_image;
+    uint32_t      m_maxDownloadSize = 0;
+    uint32_t      m_blockSize       = 4096;
+    uint32_t      m_totalBlocks     = 0;
+    size_t        m_chunk           = 0;   // index into m_image.chunks()
+    qint64        m_chunkBlockPos   = 0;   // blocks of m_chunk already emitted
+    uint32_t      m_blockPos        = 0;   // first block of the next segment
+    int           m_segments        = 0;
+    bool          m_fillUniform     = false;
+    bool          m_zeroAsDontCare  = false;
+    qint64        m_filledBytes     = 0;
+    QByteArray    m_window;                // read-ahead for unmapped sources
+    qint64        m_windowOffset    = 0;
+};
+
+// ---------------------------------------------------------------------------
+// SparseSegmentBuilder – assembles segments from block ranges pushed in
+//
+// The push-side counterpart of SparseSegmenter, for producers that generate
+// the image as they go (e.g. payload.bin operations).  Ranges may arrive in
+// any order: gaps become DONT_CARE, and a range that starts before the end
+// of the previous one closes the current segment.  Finished segments are
+// handed to the callback in the same shape SparseSegmenter::next() returns.
+// ---------------------------------------------------------------------------
+
+class SparseSegmentBuilder {
+public:
+    using SegmentCallback = std::function<bool(const QList<QByteArray>& parts)>;
+
+    SparseSegmentBuilder(uint32_t blockSize, uint32_t totalBlocks,
+                         uint32_t maxDownloadSize, SegmentCallback onSegment);
+
+    /// Add data for consecutive blocks starting at @p startBlock.  A partial
+    /// last block is zero-padded.
+    bool addData(uint32_t startBlock, const QByteArray& data);
+
+    /// Add a run of blocks that repeat one 32-bit value.
+    bool addFill(uint32_t startBlock, uint32_t blocks, uint32_t value);
+
+    /// Emit whatever is still pending.  Must be called once at the end.
+    bool finish();
+
+    /// Number of segments emitted so far.
+    int segmentCount() const { return m_segments; }
+
+private:
+    struct Record {
+        uint16_t   type   = CHUNK_TYPE_RAW;
+        uint32_t   blocks = 0;
+        uint32_t   fill   = 0;
+        QByteArray data;
+        QByteArray owner;   // keeps the buffer behind a sliced `data` alive
+    };
+
+    bool place(uint32_t startBlock, qint64 cost);
+    bool flush();
+
+    uint32_t        m_blockSize;
+    uint32_t        m_totalBlocks;
+    qint64          m_budget;
+    SegmentCallback m_onSegment;
+
+    std::vector<Record> m_records;
+    uint32_t        m_startBlock = 0;   // first block of the pending segment
+    uint32_t        m_nextBlock  = 0;   // block after the last record
+    qint64          m_used       = 0;
+    int             m_segments   = 0;
+};
+
 } // namespace sakura
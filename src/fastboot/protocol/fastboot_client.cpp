@@ -71,14 +71,23 @@ QString FastbootClient::getVariable(const QString& name)
 
 bool FastbootClient::download(const QByteArray& data)
 {
-    if (data.isEmpty()) {
+    return download(QList<QByteArray>{data});
+}
+
+bool FastbootClient::download(const QList<QByteArray>& parts)
+{
+    qint64 total = 0;
+    for (const QByteArray& part : parts)
+        total += part.size();
+
+    if (total == 0) {
         LOG_ERROR_CAT(TAG, "download: empty data");
         return false;
     }
 
     // 1. Send download:<hex-size>
     QByteArray cmd = FastbootProtocol::buildDownloadCommand(
-        static_cast<uint32_t>(data.size()));
+        static_cast<uint32_t>(total));
     m_transport->write(cmd);
 
     FastbootResponse resp = readFinalResponse();
@@ -89,7 +98,7 @@ bool FastbootClient::download(const QByteArray& data)
     }
 
     // 2. Stream the payload with progress
-    if (!sendData(data))
+    if (!sendData(parts))
         return false;
 
     // 3. Read final OKAY
@@ -104,11 +113,20 @@ bool FastbootClient::download(const QByteArray& data)
 
 bool FastbootClient::flash(const QString& partition, const QByteArray& data)
 {
+    return flash(partition, QList<QByteArray>{data});
+}
+
+bool FastbootClient::flash(const QString& partition, const QList<QByteArray>& parts)
+{
+    qint64 total = 0;
+    for (const QByteArray& part : parts)
+        total += part.size();
+
     LOG_INFO_CAT(TAG, QStringLiteral("Flashing %1 (%2 bytes)")
                           .arg(partition)
-                          .arg(data.size()));
+                          .arg(total));
 
-    if (!download(data))
+    if (!download(parts))
         return false;
 
     FastbootResponse resp = sendCommand(QStringLiteral("flash:%1").arg(partition));
@@ -207,27 +225,33 @@ FastbootResponse FastbootClient::sendCommand(const QString& command)
 
 bool FastbootClient::sendData(const QByteArray& data)
 {
-    const int chunkSize = 512 * 1024; // 512 KiB USB transfer chunks
-    qint64 total = data.size();
-    qint64 sent  = 0;
-
-    while (sent < total) {
-        qint64 remaining = total - sent;
-        int    toSend    = static_cast<int>(qMin<qint64>(remaining, chunkSize));
-        QByteArray chunk = data.mid(static_cast<int>(sent), toSend);
-
-        qint64 written = m_transport->write(chunk);
-        if (written < 0) {
-            LOG_ERROR_CAT(TAG, QStringLiteral("sendData: write failed at offset %1").arg(sent));
+    return sendData(QList<QByteArray>{data});
+}
+
+bool FastbootClient::sendData(const QList<QByteArray>& parts)
+{
+    qint64 total = 0;
+    for (const QByteArray& part : parts)
+        total += part.size();
+    qint64 sent = 0;
+
+    // Each part goes out straight from its own memory (possibly a file
+    // mapping); with the transport's event thread running, several
+    // m_transferSize transfers are queued at once
+    for (const QByteArray& data : parts) {
+        if (data.isEmpty())
+            continue;
+
+        const qint64 base = sent;
+        qint64 written = m_transport->writeSpan(
+            data.constData(), data.size(), m_transferSize, m_responseTimeoutMs,
+            [this, base, total](qint64 current, qint64) { reportProgress(base + current, total); });
+        if (written != data.size()) {
+            LOG_ERROR_CAT(TAG, QStringLiteral("sendData: write failed at offset %1")
+                                   .arg(written < 0 ? sent : sent + written));
             return false;
         }
-        if (written != toSend) {
-            LOG_WARNING_CAT(TAG, QStringLiteral("sendData: partial write %1/%2 at offset %3")
-                                     .arg(written).arg(toSend).arg(sent));
-        }
-
         sent += written;
-        reportProgress(sent, total);
     }
 
     return true;
@@ -5,6 +5,7 @@
 
 #include <QObject>
 #include <QByteArray>
+#include <QList>
 #include <QString>
 #include <functional>
 
@@ -41,9 +42,14 @@ public:
     /// Download raw data to the device RAM (download + payload).
     bool download(const QByteArray& data);
 
+    /// Download one payload supplied as consecutive buffers, e.g. generated
+    /// headers interleaved with views into a mapped image file.
+    bool download(const QList<QByteArray>& parts);
+
     /// Flash a partition with the supplied image data.
     /// Handles download + "flash:<partition>".
     bool flash(const QString& partition, const QByteArray& data);
+    bool flash(const QString& partition, const QList<QByteArray>& parts);
 
     /// Erase a partition.
     bool erase(const QString& partition);
@@ -69,6 +75,7 @@ public:
 
     /// Send raw data after a DATA response, with progress reporting.
     bool sendData(const QByteArray& data);
+    bool sendData(const QList<QByteArray>& parts);
 
     // --- Configuration -----------------------------------------------------
 
@@ -76,6 +83,11 @@ public:
     void setResponseTimeoutMs(int ms) { m_responseTimeoutMs = ms; }
     int  responseTimeoutMs() const    { return m_responseTimeoutMs; }
 
+    /// Size of each USB bulk transfer during download:.  Several MiB keeps a
+    /// USB 3 link busy; the transport queues multiple transfers when it can.
+    void setTransferSize(int bytes) { m_transferSize = qMax(512, bytes); }
+    int  transferSize() const       { return m_transferSize; }
+
     /// Maximum download size the device advertises (queried during connect).
     uint32_t maxDownloadSize() const { return m_maxDownloadSize; }
 
@@ -99,6 +111,7 @@ private:
     bool             m_connected        = false;
     uint32_t         m_maxDownloadSize  = FastbootProtocol::MAX_DOWNLOAD_SIZE_DEFAULT;
     int              m_responseTimeoutMs = 30000; // 30 s default
+    int              m_transferSize      = 1024 * 1024;
     ProgressCallback m_progressCb;
 };
 
@@ -1,8 +1,12 @@
 #include "fastboot_service.h"
+#include "fastboot/parsers/payload_parser.h"
 #include "fastboot/parsers/sparse_image.h"
 #include "core/logger.h"
 
-#include <QFile>
+#include <QElapsedTimer>
+#include <QFuture>
+#include <QtConcurrent>
+
 
 namespace sakura {
 
@@ -84,6 +88,8 @@ bool FastbootService::selectDevice(const QString& serial)
     });
     QObject::connect(m_client.get(), &FastbootClient::infoReceived,
                      this, &FastbootService::operationInfo);
+    if (m_transport->isSuperSpeed())
+        m_client->setTransferSize(4 * 1024 * 1024);
 
     if (!m_client->connect()) {
         LOG_ERROR_CAT(TAG, "Fastboot handshake failed");
@@ -167,12 +173,126 @@ FastbootDeviceInfo FastbootService::refreshDeviceInfo()
 
 bool FastbootService::flashPartition(const QString& partition, const QString& filePath)
 {
-    QByteArray data = readImageFile(filePath);
-    if (data.isEmpty()) {
+    if (!isConnected()) {
+        emit operationFinished(false, QStringLiteral("Not connected"));
+        return false;
+    }
+
+    // The image is mapped, not loaded: each segment is built when it is
+    // about to be sent and refers to the file contents in place.
+    SparseStream image;
+    if (!image.open(filePath) || image.sourceSize() == 0) {
         emit operationFinished(false, QStringLiteral("Failed to read %1").arg(filePath));
         return false;
     }
-    return flashPartition(partition, data);
+
+    const uint32_t maxDl = m_client->maxDownloadSize();
+    if (image.sourceSize() <= maxDl) {
+        if (!m_client->flash(partition, image.sourceView(0, image.sourceSize()))) {
+            emit operationFinished(false, QStringLiteral("Flash %1 failed").arg(partition));
+            return false;
+        }
+        emit operationFinished(true, QStringLiteral("Flash %1 complete").arg(partition));
+        return true;
+    }
+
+    if (!flashSegments(partition, image)) {
+        emit operationFinished(false, QStringLiteral("Sparse flash of %1 failed").arg(partition));
+        return false;
+    }
+
+    emit operationFinished(true, QStringLiteral("Flash %1 complete").arg(partition));
+    return true;
+}
+
+bool FastbootService::flashSegments(const QString& partition, SparseStream& image)
+{
+    struct PreparedSegment {
+        QList<QByteArray> parts;
+        bool   ok = false;
+        qint64 prepareMs = 0;
+    };
+
+    // Runs on a pool thread, one call at a time: builds the segment and
+    // touches every page of it so disk reads happen here rather than while
+    // the USB transfer is in progress.
+    SparseSegmenter segmenter(image, m_client->maxDownloadSize());
+    // Plain images send uniform blocks as FILL chunks; the scan happens in
+    // prepare(), one segment ahead of the transfer
+    segmenter.setFillUniformBlocks(!image.isSparseImage());
+    auto prepare = [&segmenter]() {
+        PreparedSegment seg;
+        QElapsedTimer timer;
+        timer.start();
+        seg.ok = segmenter.next(seg.parts);
+        if (seg.ok) {
+            volatile char sink = 0;
+            for (const QByteArray& part : seg.parts)
+                for (qint64 i = 0; i < part.size(); i += 4096)
+                    sink = sink + part.constData()[i];
+        }
+        seg.prepareMs = timer.elapsed();
+        return seg;
+    };
+
+    qint64 prepareMs = 0, stallMs = 0, usbMs = 0, writeMs = 0, bytes = 0;
+    QElapsedTimer phase;
+    QFuture<PreparedSegment> pending = QtConcurrent::run(prepare);
+
+    for (int index = 1;; ++index) {
+        phase.start();
+        PreparedSegment seg = pending.result();
+        stallMs += phase.elapsed();
+        prepareMs += seg.prepareMs;
+        if (!seg.ok)
+            return false;
+
+        // Segment N+1 is prepared while N is downloaded and written
+        const bool more = segmenter.hasNext();
+        if (more)
+            pending = QtConcurrent::run(prepare);
+
+        auto drainPending = [&]() {
+            if (more)
+                pending.waitForFinished();
+        };
+
+        for (const QByteArray& part : seg.parts)
+            bytes += part.size();
+
+        LOG_INFO_CAT(TAG, QStringLiteral("Flashing sparse segment %1").arg(index));
+        phase.start();
+        if (!m_client->download(seg.parts)) {
+            drainPending();
+            return false;
+        }
+        usbMs += phase.elapsed();
+
+        phase.start();
+        FastbootResponse resp = m_client->sendCommand(QStringLiteral("flash:%1").arg(partition));
+        writeMs += phase.elapsed();
+        if (!resp.isOkay()) {
+            LOG_ERROR_CAT(TAG, QStringLiteral("flash %1 failed at segment %2: %3")
+                                   .arg(partition).arg(index).arg(resp.toString()));
+            drainPending();
+            return false;
+        }
+
+        if (!more)
+            break;
+    }
+
+    const double mib = bytes / (1024.0 * 1024.0);
+    LOG_INFO_CAT(TAG, QStringLiteral("%1 flashed in %2 segment(s): prepare %3 ms (waited %4 ms), "
+                                     "USB %5 ms (%6 MiB/s), device write %7 ms")
+                          .arg(partition).arg(segmenter.segmentCount())
+                          .arg(prepareMs).arg(stallMs)
+                          .arg(usbMs).arg(usbMs > 0 ? mib * 1000.0 / usbMs : 0.0, 0, 'f', 1)
+                          .arg(writeMs));
+    if (segmenter.filledBytes() > 0)
+        LOG_INFO_CAT(TAG, QStringLiteral("%1: %2 bytes of uniform blocks sent as FILL")
+                              .arg(partition).arg(segmenter.filledBytes()));
+    return true;
 }
 
 bool FastbootService::flashPartition(const QString& partition, const QByteArray& data)
@@ -182,13 +302,18 @@ bool FastbootService::flashPartition(const QString& partition, const QByteArray&
         return false;
     }
 
-    // If the image is sparse and larger than max-download-size, re-sparse
-    // into chunks that fit.
+    // Images larger than max-download-size are (re-)sparsed into chunks
+    // that fit.
     uint32_t maxDl = m_client->maxDownloadSize();
-    if (SparseImage::isSparse(data) &&
-        static_cast<uint32_t>(data.size()) > maxDl) {
+    if (static_cast<uint32_t>(data.size()) > maxDl) {
 
-        auto chunks = SparseImage::splitForTransfer(data, maxDl);
+        auto chunks = SparseImage::isSparse(data)
+                          ? SparseImage::splitForTransfer(data, maxDl)
+                          : SparseImage::rawToTransferChunks(data, maxDl);
+        if (chunks.empty()) {
+            emit operationFinished(false, QStringLiteral("Malformed sparse image"));
+            return false;
+        }
         LOG_INFO_CAT(TAG, QStringLiteral("Sparse image split into %1 chunk(s)")
                               .arg(chunks.size()));
 
@@ -211,6 +336,54 @@ bool FastbootService::flashPartition(const QString& partition, const QByteArray&
     return true;
 }
 
+bool FastbootService::flashPayloadPartition(const QString& partition, PayloadParser& payload,
+                                            const QString& payloadName,
+                                            ProgressCallback progress)
+{
+    if (!isConnected()) {
+        emit operationFinished(false, QStringLiteral("Not connected"));
+        return false;
+    }
+
+    const PayloadPartition* part = payload.partition(payloadName);
+    if (!part) {
+        emit operationFinished(false, QStringLiteral("%1 not in payload").arg(payloadName));
+        return false;
+    }
+
+    SparseSegmentBuilder builder(
+        payload.blockSize(), static_cast<uint32_t>(payload.partitionBlocks(*part)),
+        m_client->maxDownloadSize(),
+        [this, &partition](const QList<QByteArray>& parts) {
+            return m_client->flash(partition, parts);
+        });
+
+    bool ok = payload.streamPartition(payloadName, [&builder](const PayloadExtentData& ext) {
+        const auto start = static_cast<uint32_t>(ext.startBlock);
+        switch (ext.kind) {
+        case PayloadExtentData::Kind::Data:
+            return builder.addData(start, ext.data);
+        case PayloadExtentData::Kind::Zero:
+            return builder.addFill(start, static_cast<uint32_t>(ext.numBlocks), 0);
+        case PayloadExtentData::Kind::Discard:
+            return true;    // left as a DONT_CARE gap
+        }
+        return true;
+    }, std::move(progress));
+
+    if (ok)
+        ok = builder.finish();
+
+    if (!ok) {
+        emit operationFinished(false, QStringLiteral("Flash %1 failed").arg(partition));
+        return false;
+    }
+    LOG_INFO_CAT(TAG, QStringLiteral("%1 flashed from payload in %2 segment(s)")
+                          .arg(partition).arg(builder.segmentCount()));
+    emit operationFinished(true, QStringLiteral("Flash %1 complete").arg(partition));
+    return true;
+}
+
 bool FastbootService::erasePartition(const QString& partition)
 {
     if (!isConnected()) {
@@ -270,14 +443,4 @@ void FastbootService::reportProgress(qint64 current, qint64 total)
     emit operationProgress(current, total);
 }
 
-QByteArray FastbootService::readImageFile(const QString& path)
-{
-    QFile file(path);
-    if (!file.open(QIODevice::ReadOnly)) {
-        LOG_ERROR_CAT(TAG, QStringLiteral("Cannot open %1: %2").arg(path, file.errorString()));
-        return {};
-    }
-    return file.readAll();
-}
-
 } // namespace sakura
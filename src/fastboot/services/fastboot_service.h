@@ -2,6 +2,7 @@
 
 #include "fastboot/protocol/fastboot_client.h"
 #include "transport/usb_transport.h"
+#include "common/sparse_stream.h"
 
 #include <QObject>
 #include <QMap>
@@ -14,6 +15,8 @@
 
 namespace sakura {
 
+class PayloadParser;
+
 // ---------------------------------------------------------------------------
 // Device information snapshot
 // ---------------------------------------------------------------------------
@@ -81,12 +84,22 @@ public:
 
     // --- Flash / erase -----------------------------------------------------
 
-    /// Flash a single partition from a file.
+    /// Flash a single partition from a file.  The file is mapped and sent
+    /// one max-download-size segment at a time, never loaded whole.  The
+    /// next segment is prepared on a worker thread while the current one is
+    /// downloaded and written, and per-phase timings are logged at the end.
     bool flashPartition(const QString& partition, const QString& filePath);
 
     /// Flash a single partition from in-memory data.
     bool flashPartition(const QString& partition, const QByteArray& data);
 
+    /// Flash a partition straight out of a loaded payload.bin.  Operations
+    /// are decompressed in order and packed into sparse segments in memory;
+    /// ZERO extents become FILL chunks and DISCARD extents DONT_CARE.
+    bool flashPayloadPartition(const QString& partition, PayloadParser& payload,
+                               const QString& payloadName,
+                               ProgressCallback progress = nullptr);
+
     /// Erase a single partition.
     bool erasePartition(const QString& partition);
 
@@ -118,8 +131,8 @@ signals:
 private:
     void reportProgress(qint64 current, qint64 total);
 
-    /// Read a file and split into chunks if it exceeds max-download-size.
-    QByteArray readImageFile(const QString& path);
+    /// Pipelined download + flash of an image larger than max-download-size.
+    bool flashSegments(const QString& partition, SparseStream& image);
 
     std::unique_ptr<UsbTransport>   m_transport;
     std::unique_ptr<FastbootClient> m_client;
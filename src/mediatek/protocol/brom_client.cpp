@@ -3,6 +3,7 @@
 #include "core/logger.h"
 #include "common/crc_utils.h"
 
+#include <QElapsedTimer>
 #include <QThread>
 #include <QtEndian>
 
@@ -10,6 +11,24 @@ namespace sakura {
 
 static constexpr char LOG_TAG[] = "MTK-BROM";
 
+static uint16_t statusAt(const QByteArray& reply, int offset = 0)
+{
+    if (reply.size() < offset + 2)
+        return 0xFFFF;
+    return qFromBigEndian<uint16_t>(reinterpret_cast<const uchar*>(reply.constData()) + offset);
+}
+
+static bool statusOk(uint16_t status, uint16_t expected)
+{
+    if (status != expected) {
+        LOG_ERROR_CAT(LOG_TAG, QString("Unexpected status: 0x%1 (expected 0x%2)")
+                                   .arg(status, 4, 16, QChar('0'))
+                                   .arg(expected, 4, 16, QChar('0')));
+        return false;
+    }
+    return true;
+}
+
 BromClient::BromClient(ITransport* transport, QObject* parent)
     : QObject(parent)
     , m_transport(transport)
@@ -207,37 +226,44 @@ bool BromClient::sendDa(const QByteArray& data, uint32_t loadAddr, uint32_t sigL
                               .arg(data.size())
                               .arg(loadAddr, 8, 16, QChar('0')));
 
-    if (!sendCommand(MtkBromCmd::CMD_SEND_DA))
+    // Command and parameters (echoed): load address, total length, signature length
+    QByteArray reply;
+    if (!echoBurst(MtkBromCmd::CMD_SEND_DA,
+                   { loadAddr, static_cast<uint32_t>(data.size()), sigLen }, 2, &reply))
         return false;
-
-    // Send parameters (echoed): load address, total length, signature length
-    sendWord(loadAddr);
-    sendWord(static_cast<uint32_t>(data.size()));
-    sendWord(sigLen);
-
-    if (!expectStatus(MtkBromCmd::STATUS_CONT))
+    if (!statusOk(statusAt(reply), MtkBromCmd::STATUS_CONT))
         return false;
 
-    // Stream the DA payload in 4 KiB blocks (raw write, no echo expected)
-    constexpr int BLOCK_SIZE = 4096;
-    qint64 totalSent = 0;
+    // Stream the DA payload in large bulk transfers straight from `data`
+    // (raw write, no echo expected). The checksum is folded in as each
+    // transfer completes, while the following ones are still in flight.
+    constexpr int TRANSFER_SIZE = 0x40000;  // 256 KiB, even for the checksum
+    const auto* bytes = reinterpret_cast<const uint8_t*>(data.constData());
     const qint64 totalSize = data.size();
-
-    while (totalSent < totalSize) {
-        int chunkLen = static_cast<int>(qMin<qint64>(BLOCK_SIZE, totalSize - totalSent));
-        QByteArray chunk = data.mid(static_cast<int>(totalSent), chunkLen);
-
-        if (m_transport->write(chunk) != chunkLen) {
-            LOG_ERROR_CAT(LOG_TAG, "DA transfer failed during payload send");
-            return false;
-        }
-
-        totalSent += chunkLen;
-        emit transferProgress(totalSent, totalSize);
+    uint16_t checksum = 0;
+    qint64 summed = 0;
+
+    QElapsedTimer timer;
+    timer.start();
+    qint64 sent = m_transport->writeSpan(data.constData(), totalSize, TRANSFER_SIZE,
+                                         DEFAULT_TIMEOUT, [&](qint64 current, qint64 total) {
+        // Only whole words; an odd tail waits for the next piece
+        const qint64 upto = current & ~qint64(1);
+        checksum = MtkChecksum::update(checksum, bytes + summed,
+                                       static_cast<size_t>(upto - summed));
+        summed = upto;
+        emit transferProgress(current, total);
+    });
+    if (sent != totalSize) {
+        LOG_ERROR_CAT(LOG_TAG, "DA transfer failed during payload send");
+        return false;
     }
+    if (summed != totalSize)
+        checksum = MtkChecksum::update(checksum, bytes + summed,
+                                       static_cast<size_t>(totalSize - summed));
+    LOG_INFO_CAT(LOG_TAG, QString("DA payload sent in %1 ms").arg(timer.elapsed()));
 
     // Read the device's checksum and compare
-    uint16_t checksum = MtkChecksum::compute(data);
     uint16_t devChecksum = readStatus();
 
     if (checksum != devChecksum) {
@@ -255,11 +281,9 @@ bool BromClient::jumpDa(uint32_t addr)
 {
     LOG_INFO_CAT(LOG_TAG, QString("Jump DA to 0x%1").arg(addr, 8, 16, QChar('0')));
 
-    if (!sendCommand(MtkBromCmd::CMD_JUMP_DA))
-        return false;
-
-    sendWord(addr);
-    return expectStatus();
+    QByteArray reply;
+    return echoBurst(MtkBromCmd::CMD_JUMP_DA, { addr }, 2, &reply)
+        && statusOk(statusAt(reply), MtkBromCmd::STATUS_OK);
 }
 
 // ── Security ────────────────────────────────────────────────────────────────
@@ -268,12 +292,10 @@ bool BromClient::sendCert(const QByteArray& certData)
 {
     LOG_INFO_CAT(LOG_TAG, QString("Sending certificate (%1 bytes)").arg(certData.size()));
 
-    if (!sendCommand(MtkBromCmd::CMD_SEND_CERT))
+    QByteArray reply;
+    if (!echoBurst(MtkBromCmd::CMD_SEND_CERT, { static_cast<uint32_t>(certData.size()) }, 2, &reply))
         return false;
-
-    sendWord(static_cast<uint32_t>(certData.size()));
-
-    if (!expectStatus(MtkBromCmd::STATUS_CONT))
+    if (!statusOk(statusAt(reply), MtkBromCmd::STATUS_CONT))
         return false;
 
     echoWrite(certData);
@@ -284,12 +306,10 @@ bool BromClient::sendAuth(const QByteArray& authData)
 {
     LOG_INFO_CAT(LOG_TAG, QString("Sending auth data (%1 bytes)").arg(authData.size()));
 
-    if (!sendCommand(MtkBromCmd::CMD_SEND_AUTH))
+    QByteArray reply;
+    if (!echoBurst(MtkBromCmd::CMD_SEND_AUTH, { static_cast<uint32_t>(authData.size()) }, 2, &reply))
         return false;
-
-    sendWord(static_cast<uint32_t>(authData.size()));
-
-    if (!expectStatus(MtkBromCmd::STATUS_CONT))
+    if (!statusOk(statusAt(reply), MtkBromCmd::STATUS_CONT))
         return false;
 
     echoWrite(authData);
@@ -300,35 +320,38 @@ bool BromClient::sendAuth(const QByteArray& authData)
 
 QByteArray BromClient::read32(uint32_t addr, uint32_t count)
 {
-    if (!sendCommand(MtkBromCmd::CMD_READ32))
+    QByteArray reply;
+    if (!echoBurst(MtkBromCmd::CMD_READ32, { addr, count }, 2, &reply))
         return {};
-
-    sendWord(addr);
-    sendWord(count);
-
-    if (!expectStatus(MtkBromCmd::STATUS_CONT))
+    if (!statusOk(statusAt(reply), MtkBromCmd::STATUS_CONT))
         return {};
 
-    QByteArray result = echoRead(static_cast<int>(count * 4));
-    expectStatus();
+    // Data words and the closing status arrive in a single read
+    const int dataSize = static_cast<int>(count * 4);
+    QByteArray result = echoRead(dataSize + 2);
+    if (result.size() < dataSize + 2) {
+        LOG_ERROR_CAT(LOG_TAG, QString("read32: expected %1 bytes, got %2")
+                                   .arg(dataSize + 2).arg(result.size()));
+        return {};
+    }
+    if (!statusOk(statusAt(result, dataSize), MtkBromCmd::STATUS_OK))
+        return {};
+    result.truncate(dataSize);
     return result;
 }
 
 bool BromClient::write32(uint32_t addr, const QList<uint32_t>& values)
 {
-    if (!sendCommand(MtkBromCmd::CMD_WRITE32))
+    QByteArray reply;
+    if (!echoBurst(MtkBromCmd::CMD_WRITE32,
+                   { addr, static_cast<uint32_t>(values.size()) }, 2, &reply))
         return false;
-
-    sendWord(addr);
-    sendWord(static_cast<uint32_t>(values.size()));
-
-    if (!expectStatus(MtkBromCmd::STATUS_CONT))
+    if (!statusOk(statusAt(reply), MtkBromCmd::STATUS_CONT))
         return false;
 
-    for (uint32_t v : values)
-        sendWord(v);
-
-    return expectStatus();
+    // Every value word in one burst, closing status read with the echoes
+    return echoBurst(-1, values, 2, &reply)
+        && statusOk(statusAt(reply), MtkBromCmd::STATUS_OK);
 }
 
 // ── PMIC (power management) ─────────────────────────────────────────────────
@@ -350,30 +373,31 @@ bool BromClient::pwrDeinit()
 
 uint16_t BromClient::pwrRead16(uint16_t addr)
 {
-    if (!sendCommand(MtkBromCmd::CMD_PWR_READ16))
+    // Address as 32-bit; the value word and status follow the echo
+    QByteArray reply;
+    if (!echoBurst(MtkBromCmd::CMD_PWR_READ16, { addr }, 6, &reply))
         return 0;
 
-    // Address as 32-bit
-    sendWord(static_cast<uint32_t>(addr));
-    uint16_t val = static_cast<uint16_t>(recvWord());
-    expectStatus();
+    uint16_t val = static_cast<uint16_t>(
+        qFromBigEndian<uint32_t>(reinterpret_cast<const uchar*>(reply.constData())));
+    statusOk(statusAt(reply, 4), MtkBromCmd::STATUS_OK);
     return val;
 }
 
 bool BromClient::pwrWrite16(uint16_t addr, uint16_t value)
 {
-    if (!sendCommand(MtkBromCmd::CMD_PWR_WRITE16))
-        return false;
-
-    sendWord(static_cast<uint32_t>(addr));
-    sendWord(static_cast<uint32_t>(value));
-    return expectStatus();
+    QByteArray reply;
+    return echoBurst(MtkBromCmd::CMD_PWR_WRITE16, { addr, value }, 2, &reply)
+        && statusOk(statusAt(reply), MtkBromCmd::STATUS_OK);
 }
 
 // ── Private helpers (BROM echo protocol) ────────────────────────────────────
 // In the MTK BROM echo protocol, every command byte and parameter word sent
 // by the host is echoed back by the device. We MUST read the echo to keep
 // the buffer in sync. See mtkclient Port.py echo() method.
+// The device only consumes the echo stream in order, so a command and its
+// parameter words can be written back to back and their echoes (plus any
+// reply that follows without further host input) collected in one read.
 
 bool BromClient::sendCommand(uint8_t cmd)
 {
@@ -398,14 +422,7 @@ bool BromClient::sendCommand(uint8_t cmd)
 
 bool BromClient::expectStatus(uint16_t expected)
 {
-    uint16_t status = readStatus();
-    if (status != expected) {
-        LOG_ERROR_CAT(LOG_TAG, QString("Unexpected status: 0x%1 (expected 0x%2)")
-                                   .arg(status, 4, 16, QChar('0'))
-                                   .arg(expected, 4, 16, QChar('0')));
-        return false;
-    }
-    return true;
+    return statusOk(readStatus(), expected);
 }
 
 QByteArray BromClient::echoRead(int size, int timeoutMs)
@@ -437,19 +454,26 @@ uint16_t BromClient::readStatus()
     return qFromBigEndian<uint16_t>(reinterpret_cast<const uchar*>(resp.constData()));
 }
 
-void BromClient::sendWord(uint32_t value)
+bool BromClient::sendWord(uint32_t value)
 {
     uint32_t be = qToBigEndian(value);
     QByteArray data(reinterpret_cast<const char*>(&be), 4);
-    m_transport->write(data);
+    if (m_transport->write(data) != 4)
+        return false;
 
     // Read the echo (BROM echoes every word back)
     QByteArray echo = m_transport->readExact(4, DEFAULT_TIMEOUT);
-    if (echo.size() == 4 && echo != data) {
+    if (echo.size() != 4) {
+        LOG_ERROR_CAT(LOG_TAG, QString("No echo for word 0x%1").arg(value, 8, 16, QChar('0')));
+        return false;
+    }
+    if (echo != data) {
         LOG_WARNING_CAT(LOG_TAG, QString("sendWord echo mismatch: sent 0x%1, got 0x%2")
                                      .arg(value, 8, 16, QChar('0'))
                                      .arg(qFromBigEndian<uint32_t>(reinterpret_cast<const uchar*>(echo.constData())), 8, 16, QChar('0')));
+        return false;
     }
+    return true;
 }
 
 uint32_t BromClient::recvWord()
@@ -460,4 +484,76 @@ uint32_t BromClient::recvWord()
     return qFromBigEndian<uint32_t>(reinterpret_cast<const uchar*>(resp.constData()));
 }
 
+bool BromClient::echoBurst(int cmd, const QList<uint32_t>& words,
+                           int replySize, QByteArray* reply)
+{
+    if (!m_burstEcho) {
+        if (!echoPerWord(cmd, words))
+            return false;
+        if (replySize > 0) {
+            QByteArray resp = m_transport->readExact(replySize, DEFAULT_TIMEOUT);
+            if (resp.size() != replySize)
+                return false;
+            if (reply)
+                *reply = resp;
+        }
+        return true;
+    }
+
+    const int cmdSize = cmd >= 0 ? 1 : 0;
+    QByteArray out(cmdSize + words.size() * 4, Qt::Uninitialized);
+    auto* p = reinterpret_cast<uchar*>(out.data());
+    if (cmdSize)
+        *p++ = static_cast<uchar>(cmd);
+    for (uint32_t w : words) {
+        qToBigEndian(w, p);
+        p += 4;
+    }
+
+    if (m_transport->write(out) != out.size()) {
+        LOG_ERROR_CAT(LOG_TAG, QString("Burst write of %1 bytes failed").arg(out.size()));
+        return false;
+    }
+
+    QByteArray in = m_transport->readExact(out.size() + replySize, DEFAULT_TIMEOUT);
+    const int echoed = static_cast<int>(qMin(in.size(), out.size()));
+    int diff = 0;
+    while (diff < echoed && in[diff] == out[diff])
+        ++diff;
+
+    if (diff < out.size()) {
+        // The burst is already on the wire and the device state is unknown,
+        // so the transaction cannot be replayed. Report the first bad unit
+        // and drop any late echo/reply bytes so the next command starts clean.
+        QString where = (cmdSize && diff == 0)
+            ? QString("command 0x%1").arg(cmd, 2, 16, QChar('0'))
+            : QString("word %1 of %2").arg((diff - cmdSize) / 4 + 1).arg(words.size());
+        LOG_ERROR_CAT(LOG_TAG, QString("Burst echo %1 at %2 (%3/%4 bytes echoed)")
+                                   .arg(diff < echoed ? "mismatch" : "short")
+                                   .arg(where).arg(in.size()).arg(out.size()));
+        m_transport->discardInput();
+        return false;
+    }
+    if (in.size() < out.size() + replySize) {
+        LOG_ERROR_CAT(LOG_TAG, QString("Expected %1 reply bytes after echo, got %2")
+                                   .arg(replySize).arg(in.size() - out.size()));
+        m_transport->discardInput();
+        return false;
+    }
+    if (reply)
+        *reply = in.mid(out.size());
+    return true;
+}
+
+bool BromClient::echoPerWord(int cmd, const QList<uint32_t>& words)
+{
+    if (cmd >= 0 && !sendCommand(static_cast<uint8_t>(cmd)))
+        return false;
+    for (uint32_t w : words) {
+        if (!sendWord(w))
+            return false;
+    }
+    return true;
+}
+
 } // namespace sakura
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <QByteArray>
+#include <QList>
 #include <QObject>
 #include <QString>
 #include <cstdint>
@@ -102,6 +103,12 @@ public:
     uint16_t pwrRead16(uint16_t addr);
     bool pwrWrite16(uint16_t addr, uint16_t value);
 
+    // Parameter words normally go out as one burst whose echoes are checked
+    // with a single read. A bad echo fails the transaction; disabling burst
+    // mode sends one word per round-trip for ports that drop bytes on bursts.
+    void setBurstEcho(bool enabled) { m_burstEcho = enabled; }
+    bool burstEcho() const { return m_burstEcho; }
+
 signals:
     void transferProgress(qint64 sent, qint64 total);
 
@@ -111,10 +118,16 @@ private:
     QByteArray echoRead(int size, int timeoutMs = 5000);
     bool echoWrite(const QByteArray& data);
     uint16_t readStatus();
-    void sendWord(uint32_t value);
+    bool sendWord(uint32_t value);
     uint32_t recvWord();
+    // Sends `cmd` (if >= 0) followed by `words`, verifies every echo and then
+    // reads `replySize` response bytes into `reply` (status words, data)
+    bool echoBurst(int cmd, const QList<uint32_t>& words,
+                   int replySize = 0, QByteArray* reply = nullptr);
+    bool echoPerWord(int cmd, const QList<uint32_t>& words);
 
     ITransport* m_transport = nullptr;
+    bool m_burstEcho = true;
     static constexpr int DEFAULT_TIMEOUT = 5000;
 };
 
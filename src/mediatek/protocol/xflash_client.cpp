@@ -1,9 +1,13 @@
 #include "xflash_client.h"
+#include "transport/buffer_pool.h"
 #include "transport/i_transport.h"
 #include "common/gpt_parser.h"
 #include "core/logger.h"
 
+#include <QBuffer>
 #include <QtEndian>
+#include <cstring>
+#include <limits>
 
 namespace sakura {
 
@@ -51,54 +55,47 @@ QList<PartitionInfo> XFlashClient::readPartitions()
 
 bool XFlashClient::writePartition(const QString& name, const QByteArray& data)
 {
-    LOG_INFO_CAT(LOG_TAG, QString("Writing partition '%1' (%2 bytes)").arg(name).arg(data.size()));
+    QBuffer buffer;
+    buffer.setData(data);
+    buffer.open(QIODevice::ReadOnly);
+    return writePartition(name, &buffer, data.size());
+}
 
-    // Build argument payload: partition name (UTF-8, null-terminated) + data length
-    QByteArray nameBytes = name.toUtf8();
-    nameBytes.append('\0');
+bool XFlashClient::writePartition(const QString& name, QIODevice* source, qint64 size)
+{
+    if (size < 0)
+        size = source->size() - source->pos();
+    LOG_INFO_CAT(LOG_TAG, QString("Writing partition '%1' (%2 bytes)").arg(name).arg(size));
 
-    QByteArray args;
-    args.reserve(nameBytes.size() + 8 + data.size());
-    args.append(nameBytes);
+    // Build argument payload: partition name (UTF-8, null-terminated) + data length
+    QByteArray args = name.toUtf8();
+    args.append('\0');
 
     // Append 64-bit data length (little-endian)
-    uint64_t dataLen = static_cast<uint64_t>(data.size());
-    uint64_t leLen = qToLittleEndian(dataLen);
+    uint64_t leLen = qToLittleEndian(static_cast<uint64_t>(size));
     args.append(reinterpret_cast<const char*>(&leLen), 8);
 
     if (!sendPacket(XFlashConst::DT_PROTOCOL_FLOW, XFlashConst::CMD_WRITE_PARTITION, args))
         return false;
 
-    // Stream data in blocks
-    constexpr int BLOCK_SIZE = 0x40000; // 256 KiB
-    qint64 totalSent = 0;
-    const qint64 totalSize = data.size();
-
-    while (totalSent < totalSize) {
-        int chunkLen = static_cast<int>(qMin<qint64>(BLOCK_SIZE, totalSize - totalSent));
-        QByteArray chunk = data.mid(static_cast<int>(totalSent), chunkLen);
-        qint64 written = m_transport->write(chunk);
-        if (written != chunkLen) {
-            LOG_ERROR_CAT(LOG_TAG, QString("Write failed at offset %1: wrote %2/%3")
-                                       .arg(totalSent).arg(written).arg(chunkLen));
-            return false;
-        }
-        totalSent += chunkLen;
-        emit transferProgress(totalSent, totalSize);
-    }
-
-    return checkStatus();
+    return sendBlocks(XFlashConst::CMD_WRITE_PARTITION, source, size);
 }
 
 QByteArray XFlashClient::readPartition(const QString& name, qint64 offset, qint64 length)
+{
+    QBuffer buffer;
+    buffer.open(QIODevice::WriteOnly);
+    if (!readPartition(name, &buffer, offset, length))
+        return {};
+    return buffer.data();
+}
+
+bool XFlashClient::readPartition(const QString& name, QIODevice* sink, qint64 offset, qint64 length)
 {
     LOG_INFO_CAT(LOG_TAG, QString("Reading partition '%1'").arg(name));
 
-    QByteArray nameBytes = name.toUtf8();
-    nameBytes.append('\0');
-
-    QByteArray args;
-    args.append(nameBytes);
+    QByteArray args = name.toUtf8();
+    args.append('\0');
 
     // Append offset and length (64-bit LE)
     uint64_t leOffset = qToLittleEndian(static_cast<uint64_t>(offset));
@@ -107,20 +104,9 @@ QByteArray XFlashClient::readPartition(const QString& name, qint64 offset, qint6
     args.append(reinterpret_cast<const char*>(&leLength), 8);
 
     if (!sendPacket(XFlashConst::DT_PROTOCOL_FLOW, XFlashConst::CMD_READ_PARTITION, args))
-        return {};
-
-    // Receive data in chunks
-    XFlashPacketHeader hdr = recvHeader();
-    if (hdr.magic != XFlashConst::MAGIC) {
-        LOG_ERROR_CAT(LOG_TAG, "readPartition: invalid response magic");
-        return {};
-    }
-    QByteArray result = recvPayload(hdr.length);
+        return false;
 
-    if (!checkStatus()) {
-        LOG_WARNING_CAT(LOG_TAG, "readPartition: status check failed after data");
-    }
-    return result;
+    return receiveBlocks(sink, length);
 }
 
 bool XFlashClient::erasePartition(const QString& name)
@@ -152,6 +138,15 @@ bool XFlashClient::formatPartition(const QString& name)
 // ── Flash-level operations ──────────────────────────────────────────────────
 
 QByteArray XFlashClient::readFlash(uint64_t offset, uint64_t length)
+{
+    QBuffer buffer;
+    buffer.open(QIODevice::WriteOnly);
+    if (!readFlash(offset, length, &buffer))
+        return {};
+    return buffer.data();
+}
+
+bool XFlashClient::readFlash(uint64_t offset, uint64_t length, QIODevice* sink)
 {
     QByteArray args;
     uint64_t leOff = qToLittleEndian(offset);
@@ -160,34 +155,140 @@ QByteArray XFlashClient::readFlash(uint64_t offset, uint64_t length)
     args.append(reinterpret_cast<const char*>(&leLen), 8);
 
     if (!sendPacket(XFlashConst::DT_PROTOCOL_FLOW, XFlashConst::CMD_READ_FLASH, args))
-        return {};
+        return false;
 
-    XFlashPacketHeader hdr = recvHeader();
-    if (hdr.magic != XFlashConst::MAGIC) {
-        LOG_ERROR_CAT(LOG_TAG, "readFlash: invalid response magic");
-        return {};
-    }
-    return recvPayload(hdr.length);
+    return receiveBlocks(sink, static_cast<qint64>(length));
 }
 
 bool XFlashClient::writeFlash(uint64_t offset, const QByteArray& data)
+{
+    QBuffer buffer;
+    buffer.setData(data);
+    buffer.open(QIODevice::ReadOnly);
+    return writeFlash(offset, &buffer, data.size());
+}
+
+bool XFlashClient::writeFlash(uint64_t offset, QIODevice* source, qint64 size)
 {
     QByteArray args;
     uint64_t leOff = qToLittleEndian(offset);
-    uint64_t leLen = qToLittleEndian(static_cast<uint64_t>(data.size()));
+    uint64_t leLen = qToLittleEndian(static_cast<uint64_t>(size));
     args.append(reinterpret_cast<const char*>(&leOff), 8);
     args.append(reinterpret_cast<const char*>(&leLen), 8);
 
     if (!sendPacket(XFlashConst::DT_PROTOCOL_FLOW, XFlashConst::CMD_WRITE_FLASH, args))
         return false;
 
-    qint64 written = m_transport->write(data);
-    if (written != data.size()) {
-        LOG_ERROR_CAT(LOG_TAG, QString("writeFlash: wrote %1/%2 bytes")
-                                   .arg(written).arg(data.size()));
+    return sendBlocks(XFlashConst::CMD_WRITE_FLASH, source, size);
+}
+
+// ── Block transfers ─────────────────────────────────────────────────────────
+//
+// Device → host: the DA sends data packets of up to one block, the host
+// acknowledges each with a STATUS_OK packet, and a packet without payload
+// ends the stream carrying the command status.
+// Host → device: the host sends data packets of up to one block and waits
+// for the DA's status after each, then for the final command status.
+
+int XFlashClient::timeoutFor(qint64 bytes)
+{
+    return static_cast<int>(qMin<qint64>(DEFAULT_TIMEOUT + bytes / MIN_BYTES_PER_MS,
+                                         std::numeric_limits<int>::max()));
+}
+
+bool XFlashClient::receiveBlocks(QIODevice* sink, qint64 expected)
+{
+    PooledBuffer block = BufferPool::instance().acquire(static_cast<int>(m_blockSize));
+    qint64 received = 0;
+    const int blockTimeout = timeoutFor(m_blockSize);
+
+    for (;;) {
+        XFlashPacketHeader hdr = recvHeader(blockTimeout);
+        if (hdr.magic != XFlashConst::MAGIC)
+            return false;
+
+        if (hdr.length <= 4) {
+            if (hdr.command != XFlashConst::STATUS_OK) {
+                LOG_ERROR_CAT(LOG_TAG, QString("XFlash error: 0x%1")
+                                           .arg(hdr.command, 8, 16, QChar('0')));
+                return false;
+            }
+            break;
+        }
+
+        const qint64 len = hdr.length - 4;
+        // A block far beyond what was negotiated means a corrupted header
+        if (len > qMax<qint64>(4LL * m_blockSize, 16 * 1024 * 1024)) {
+            LOG_ERROR_CAT(LOG_TAG, QString("Data block of %1 bytes exceeds limit").arg(len));
+            return false;
+        }
+        if (block.size() < len)
+            block.resize(static_cast<int>(len));
+        if (m_transport->readInto(block.data(), len, timeoutFor(len)) != len) {
+            LOG_ERROR_CAT(LOG_TAG, QString("Short data block at offset %1").arg(received));
+            return false;
+        }
+        if (sink->write(block.constData(), len) != len) {
+            LOG_ERROR_CAT(LOG_TAG, QString("Sink write failed: %1").arg(sink->errorString()));
+            return false;
+        }
+        received += len;
+
+        if (!sendPacket(XFlashConst::DT_PROTOCOL_FLOW, XFlashConst::STATUS_OK))
+            return false;
+        emit transferProgress(received, expected > 0 ? expected : received);
+    }
+
+    if (expected > 0 && received != expected) {
+        LOG_ERROR_CAT(LOG_TAG, QString("Received %1 of %2 bytes").arg(received).arg(expected));
         return false;
     }
-    return checkStatus();
+    return true;
+}
+
+bool XFlashClient::sendBlocks(uint32_t command, QIODevice* source, qint64 total)
+{
+    // Header and data leave in one write; the pooled buffer is reused per block
+    constexpr qint64 HDR = sizeof(XFlashPacketHeader);
+    PooledBuffer packet = BufferPool::instance().acquire(static_cast<int>(HDR + m_blockSize));
+    const int blockTimeout = timeoutFor(m_blockSize);
+    qint64 sent = 0;
+
+    while (sent < total) {
+        const qint64 len = qMin<qint64>(m_blockSize, total - sent);
+        char* data = packet.data() + HDR;
+        for (qint64 got = 0; got < len;) {
+            qint64 n = source->read(data + got, len - got);
+            if (n <= 0) {
+                LOG_ERROR_CAT(LOG_TAG, QString("Source ended at offset %1 of %2")
+                                           .arg(sent + got).arg(total));
+                return false;
+            }
+            got += n;
+        }
+
+        XFlashPacketHeader hdr;
+        hdr.magic    = qToLittleEndian(XFlashConst::MAGIC);
+        hdr.dataType = qToLittleEndian(XFlashConst::DT_PROTOCOL_FLOW);
+        hdr.length   = qToLittleEndian(static_cast<uint32_t>(4 + len));
+        hdr.command  = qToLittleEndian(command);
+        std::memcpy(packet.data(), &hdr, HDR);
+
+        qint64 written = m_transport->writeFrom(packet.constData(), HDR + len);
+        if (written != HDR + len) {
+            LOG_ERROR_CAT(LOG_TAG, QString("Write failed at offset %1: wrote %2/%3")
+                                       .arg(sent).arg(written).arg(HDR + len));
+            return false;
+        }
+        if (!checkStatus(blockTimeout)) {
+            LOG_ERROR_CAT(LOG_TAG, QString("Block at offset %1 rejected").arg(sent));
+            return false;
+        }
+        sent += len;
+        emit transferProgress(sent, total);
+    }
+
+    return checkStatus(blockTimeout);
 }
 
 // ── Device info ─────────────────────────────────────────────────────────────
@@ -251,10 +352,10 @@ bool XFlashClient::sendPacket(uint32_t dataType, uint32_t command,
     return m_transport->write(pkt) == pkt.size();
 }
 
-XFlashPacketHeader XFlashClient::recvHeader()
+XFlashPacketHeader XFlashClient::recvHeader(int timeoutMs)
 {
     XFlashPacketHeader hdr{};
-    QByteArray raw = m_transport->readExact(sizeof(XFlashPacketHeader), DEFAULT_TIMEOUT);
+    QByteArray raw = m_transport->readExact(sizeof(XFlashPacketHeader), timeoutMs);
 
     if (raw.size() < static_cast<int>(sizeof(XFlashPacketHeader))) {
         LOG_ERROR_CAT(LOG_TAG, QString("recvHeader: short read (%1 bytes)").arg(raw.size()));
@@ -288,9 +389,9 @@ QByteArray XFlashClient::recvPayload(uint32_t length)
     return m_transport->readExact(static_cast<int>(payloadLen), DEFAULT_TIMEOUT);
 }
 
-bool XFlashClient::checkStatus()
+bool XFlashClient::checkStatus(int timeoutMs)
 {
-    XFlashPacketHeader hdr = recvHeader();
+    XFlashPacketHeader hdr = recvHeader(timeoutMs);
     if (hdr.magic != XFlashConst::MAGIC) {
         LOG_ERROR_CAT(LOG_TAG, "Invalid status response magic");
         return false;
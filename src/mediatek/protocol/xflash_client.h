@@ -1,6 +1,7 @@
 #pragma once
 
 #include <QByteArray>
+#include <QIODevice>
 #include <QList>
 #include <QObject>
 #include <QString>
@@ -70,16 +71,28 @@ public:
     explicit XFlashClient(ITransport* transport, QObject* parent = nullptr);
     ~XFlashClient() override;
 
+    // Bulk data moves in packets of at most blockSize() bytes, each one
+    // acknowledged before the next is sent
+    void setBlockSize(uint32_t size) { m_blockSize = qMax<uint32_t>(size, 512); }
+    uint32_t blockSize() const { return m_blockSize; }
+
     // Partition operations
     QList<PartitionInfo> readPartitions();
     bool writePartition(const QString& name, const QByteArray& data);
     QByteArray readPartition(const QString& name, qint64 offset = 0, qint64 length = -1);
+    // Streaming variants: memory use is one block regardless of size.
+    // `size` < 0 writes from the current position of `source` to its end.
+    bool writePartition(const QString& name, QIODevice* source, qint64 size = -1);
+    bool readPartition(const QString& name, QIODevice* sink,
+                       qint64 offset = 0, qint64 length = -1);
     bool erasePartition(const QString& name);
     bool formatPartition(const QString& name);
 
     // Flash-level operations
     QByteArray readFlash(uint64_t offset, uint64_t length);
     bool writeFlash(uint64_t offset, const QByteArray& data);
+    bool readFlash(uint64_t offset, uint64_t length, QIODevice* sink);
+    bool writeFlash(uint64_t offset, QIODevice* source, qint64 size);
 
     // Device info
     XFlashDaInfo getDaInfo();
@@ -96,12 +109,21 @@ private:
                            const QByteArray& payload = {}) const;
     bool sendPacket(uint32_t dataType, uint32_t command,
                     const QByteArray& payload = {});
-    XFlashPacketHeader recvHeader();
+    XFlashPacketHeader recvHeader(int timeoutMs = DEFAULT_TIMEOUT);
     QByteArray recvPayload(uint32_t length);
-    bool checkStatus();
+    bool checkStatus(int timeoutMs = DEFAULT_TIMEOUT);
+
+    // Block transfer loops shared by the partition and flash commands
+    bool receiveBlocks(QIODevice* sink, qint64 expected);
+    bool sendBlocks(uint32_t command, QIODevice* source, qint64 total);
+
+    // Fixed allowance plus the time the bytes take at a slow link speed
+    static int timeoutFor(qint64 bytes);
 
     ITransport* m_transport = nullptr;
+    uint32_t m_blockSize = 0x40000;     // 256 KiB
     static constexpr int DEFAULT_TIMEOUT = 10000;
+    static constexpr qint64 MIN_BYTES_PER_MS = 1024;    // ~1 MB/s
 };
 
 } // namespace sakura
@@ -3,10 +3,15 @@
 #include "common/gpt_parser.h"
 #include "core/logger.h"
 
+#include <QBuffer>
 #include <QDomElement>
 #include <QDomNodeList>
 #include <QMap>
+#include <QFuture>
+#include <QtConcurrent>
 #include <QtEndian>
+#include <cstring>
+#include <utility>
 
 namespace sakura {
 
@@ -106,28 +111,59 @@ QList<PartitionInfo> XmlDaClient::readPartitions()
 }
 
 bool XmlDaClient::writePartition(const QString& name, const QByteArray& data)
+{
+    if (!beginWrite(name, data.size()))
+        return false;
+
+    // Send binary payload after XML handshake
+    return sendBinaryPayload(data);
+}
+
+bool XmlDaClient::writePartition(const QString& name, QIODevice* source, qint64 size)
+{
+    if (size < 0)
+        size = source->size() - source->pos();
+    if (!beginWrite(name, size))
+        return false;
+
+    return sendBinaryPayload(source, size);
+}
+
+bool XmlDaClient::beginWrite(const QString& name, qint64 size)
 {
     LOG_INFO_CAT(LOG_TAG, QString("Writing partition '%1' (%2 bytes) via XML DA")
-                              .arg(name).arg(data.size()));
+                              .arg(name).arg(size));
 
     QMap<QString, QString> params;
     params["partition"]   = name;
     params["offset"]      = "0x0";
-    params["length"]      = QString("0x%1").arg(data.size(), 0, 16);
+    params["length"]      = QString("0x%1").arg(size, 0, 16);
 
     QString xml = buildXmlCommand(XmlDaCmd::CMD_WRITE_PARTITION, params);
     if (!sendXml(xml))
         return false;
 
     QDomDocument resp = recvXmlResponse();
-    if (!isResponseOk(resp))
-        return false;
-
-    // Send binary payload after XML handshake
-    return sendBinaryPayload(data);
+    return isResponseOk(resp);
 }
 
 QByteArray XmlDaClient::readPartition(const QString& name, qint64 offset, qint64 length)
+{
+    qint64 size = beginRead(name, offset, length);
+    if (size <= 0)
+        return {};
+    return recvBinaryPayload(size);
+}
+
+bool XmlDaClient::readPartition(const QString& name, QIODevice* sink, qint64 offset, qint64 length)
+{
+    qint64 size = beginRead(name, offset, length);
+    if (size <= 0)
+        return false;
+    return recvBinaryPayload(sink, size);
+}
+
+qint64 XmlDaClient::beginRead(const QString& name, qint64 offset, qint64 length)
 {
     LOG_INFO_CAT(LOG_TAG, QString("Reading partition '%1' via XML DA").arg(name));
 
@@ -139,11 +175,11 @@ QByteArray XmlDaClient::readPartition(const QString& name, qint64 offset, qint64
 
     QString xml = buildXmlCommand(XmlDaCmd::CMD_READ_PARTITION, params);
     if (!sendXml(xml))
-        return {};
+        return -1;
 
     QDomDocument resp = recvXmlResponse();
     if (!isResponseOk(resp))
-        return {};
+        return -1;
 
     // Determine expected size from response
     QString sizeStr = getResponseField(resp, "length");
@@ -151,10 +187,9 @@ QByteArray XmlDaClient::readPartition(const QString& name, qint64 offset, qint64
     qint64 expectedSize = sizeStr.toLongLong(&sizeOk, 0);
     if (!sizeOk || expectedSize <= 0) {
         LOG_ERROR_CAT(LOG_TAG, QString("Invalid read size: '%1'").arg(sizeStr));
-        return {};
+        return -1;
     }
-
-    return recvBinaryPayload(expectedSize);
+    return expectedSize;
 }
 
 bool XmlDaClient::erasePartition(const QString& name)
@@ -389,24 +424,177 @@ QString XmlDaClient::getResponseField(const QDomDocument& doc, const QString& fi
 }
 
 // ── Binary payload transfer ─────────────────────────────────────────────────
+//
+// Disk I/O runs one block ahead of (or behind) the transport on a worker
+// thread, so reading the image or writing the dump overlaps the USB
+// transfer. Memory use is two blocks regardless of the partition size.
+
+static constexpr int BLOCK_SIZE = 0x40000; // 256 KiB
+
+namespace {
+
+// Reads `source` one block ahead into a back buffer
+class BlockPrefetcher {
+public:
+    BlockPrefetcher(QIODevice* source, qint64 total)
+        : m_source(source), m_remaining(total)
+        , m_front(BLOCK_SIZE, Qt::Uninitialized), m_back(BLOCK_SIZE, Qt::Uninitialized)
+    {
+        startRead();
+    }
+    ~BlockPrefetcher() { m_pending.waitForFinished(); }
+
+    // Copies up to maxSize bytes into dst: count, 0 at the end, -1 on error
+    qint64 next(char* dst, qint64 maxSize)
+    {
+        if (m_pos == m_len) {
+            if (!m_pending.isValid())
+                return 0;
+            m_len = m_pending.result();
+            m_pending = QFuture<qint64>();
+            if (m_len <= 0)
+                return m_len;
+            std::swap(m_front, m_back);
+            m_pos = 0;
+            startRead();
+        }
+        const qint64 n = qMin(maxSize, m_len - m_pos);
+        std::memcpy(dst, m_front.constData() + m_pos, static_cast<size_t>(n));
+        m_pos += n;
+        return n;
+    }
+
+private:
+    void startRead()
+    {
+        const qint64 want = qMin<qint64>(m_back.size(), m_remaining);
+        if (want <= 0)
+            return;
+        m_remaining -= want;
+        char* dst = m_back.data();
+        QIODevice* src = m_source;
+        m_pending = QtConcurrent::run([src, dst, want]() -> qint64 {
+            for (qint64 got = 0; got < want;) {
+                qint64 n = src->read(dst + got, want - got);
+                if (n <= 0) {
+                    LOG_ERROR_CAT(LOG_TAG, QString("Source read failed: %1").arg(src->errorString()));
+                    return -1;
+                }
+                got += n;
+            }
+            return want;
+        });
+    }
+
+    QIODevice* m_source;
+    qint64 m_remaining;
+    QByteArray m_front, m_back;
+    qint64 m_pos = 0, m_len = 0;
+    QFuture<qint64> m_pending;
+};
+
+// Collects received data into blocks and writes each one to `sink` while
+// the next is being received
+class BlockWriteBehind {
+public:
+    explicit BlockWriteBehind(QIODevice* sink)
+        : m_sink(sink)
+        , m_fill(BLOCK_SIZE, Qt::Uninitialized), m_busy(BLOCK_SIZE, Qt::Uninitialized)
+    {
+    }
+    ~BlockWriteBehind() { m_pending.waitForFinished(); }
+
+    bool append(const char* data, qint64 size)
+    {
+        while (size > 0) {
+            const qint64 n = qMin<qint64>(m_fill.size() - m_used, size);
+            std::memcpy(m_fill.data() + m_used, data, static_cast<size_t>(n));
+            m_used += n;
+            data += n;
+            size -= n;
+            if (m_used == m_fill.size() && !flush())
+                return false;
+        }
+        return true;
+    }
+
+    bool finish()
+    {
+        if (m_used > 0 && !flush())
+            return false;
+        return wait();
+    }
+
+private:
+    bool wait()
+    {
+        if (!m_pending.isValid())
+            return true;
+        bool ok = m_pending.result();
+        m_pending = QFuture<bool>();
+        return ok;
+    }
+
+    bool flush()
+    {
+        if (!wait())
+            return false;
+        std::swap(m_fill, m_busy);
+        const char* src = m_busy.constData();
+        const qint64 len = m_used;
+        QIODevice* sink = m_sink;
+        m_used = 0;
+        m_pending = QtConcurrent::run([sink, src, len]() {
+            if (sink->write(src, len) == len)
+                return true;
+            LOG_ERROR_CAT(LOG_TAG, QString("Sink write failed: %1").arg(sink->errorString()));
+            return false;
+        });
+        return true;
+    }
+
+    QIODevice* m_sink;
+    QByteArray m_fill, m_busy;
+    qint64 m_used = 0;
+    QFuture<bool> m_pending;
+};
+
+} // namespace
 
 bool XmlDaClient::sendBinaryPayload(const QByteArray& data)
 {
-    constexpr int BLOCK_SIZE = 0x40000; // 256 KiB
-    qint64 totalSent = 0;
-    const qint64 totalSize = data.size();
+    // Already in memory: sent in place
+    qint64 sent = m_transport->writeSpan(data.constData(), data.size(), BLOCK_SIZE, DEFAULT_TIMEOUT,
+                                         [this](qint64 current, qint64 total) {
+                                             emit transferProgress(current, total);
+                                         });
+    if (sent != data.size()) {
+        LOG_ERROR_CAT(LOG_TAG, "Binary payload send failed");
+        return false;
+    }
 
-    while (totalSent < totalSize) {
-        int chunkLen = static_cast<int>(qMin<qint64>(BLOCK_SIZE, totalSize - totalSent));
-        QByteArray chunk = data.mid(static_cast<int>(totalSent), chunkLen);
+    // Wait for final status XML
+    QDomDocument resp = recvXmlResponse();
+    return isResponseOk(resp);
+}
 
-        if (m_transport->write(chunk) != chunkLen) {
-            LOG_ERROR_CAT(LOG_TAG, "Binary payload send failed");
-            return false;
+bool XmlDaClient::sendBinaryPayload(QIODevice* source, qint64 size)
+{
+    BlockPrefetcher prefetch(source, size);
+    qint64 filled = 0;
+    qint64 sent = m_transport->writeStream(size, [&](char* dst, qint64 maxSize) -> qint64 {
+        qint64 n = prefetch.next(dst, maxSize);
+        if (n > 0) {
+            filled += n;
+            emit transferProgress(filled, size);
         }
+        return n;
+    }, BLOCK_SIZE, DEFAULT_TIMEOUT);
 
-        totalSent += chunkLen;
-        emit transferProgress(totalSent, totalSize);
+    if (sent != size) {
+        LOG_ERROR_CAT(LOG_TAG, QString("Binary payload send failed: %1/%2 bytes")
+                                   .arg(qMax<qint64>(sent, 0)).arg(size));
+        return false;
     }
 
     // Wait for final status XML
@@ -419,32 +607,36 @@ QByteArray XmlDaClient::recvBinaryPayload(qint64 expectedSize)
     if (expectedSize <= 0)
         return {};
 
-    constexpr int BLOCK_SIZE = 0x40000;
-    QByteArray result;
-    result.reserve(static_cast<int>(expectedSize));
-
-    qint64 remaining = expectedSize;
-    while (remaining > 0) {
-        int chunkLen = static_cast<int>(qMin<qint64>(BLOCK_SIZE, remaining));
-        QByteArray chunk = m_transport->readExact(chunkLen, DEFAULT_TIMEOUT);
+    QBuffer buffer;
+    buffer.open(QIODevice::WriteOnly);
+    if (!recvBinaryPayload(&buffer, expectedSize))
+        return {};
+    return buffer.data();
+}
 
-        if (chunk.isEmpty()) {
-            LOG_ERROR_CAT(LOG_TAG, QString("Binary payload recv failed: got %1/%2 bytes")
-                                       .arg(result.size()).arg(expectedSize));
-            break;
-        }
+bool XmlDaClient::recvBinaryPayload(QIODevice* sink, qint64 expectedSize)
+{
+    if (expectedSize <= 0)
+        return false;
 
-        result.append(chunk);
-        remaining -= chunk.size();
-        emit transferProgress(expectedSize - remaining, expectedSize);
-    }
+    BlockWriteBehind writer(sink);
+    qint64 received = 0;
+    qint64 got = m_transport->readStream(expectedSize, [&](const char* data, qint64 size) {
+        if (!writer.append(data, size))
+            return false;
+        received += size;
+        emit transferProgress(received, expectedSize);
+        return true;
+    }, BLOCK_SIZE, DEFAULT_TIMEOUT);
 
-    if (result.size() != expectedSize) {
-        LOG_WARNING_CAT(LOG_TAG, QString("Incomplete binary payload: %1/%2 bytes")
-                                     .arg(result.size()).arg(expectedSize));
+    if (!writer.finish())
+        return false;
+    if (got != expectedSize) {
+        LOG_ERROR_CAT(LOG_TAG, QString("Binary payload recv failed: got %1/%2 bytes")
+                                   .arg(received).arg(expectedSize));
+        return false;
     }
-
-    return result;
+    return true;
 }
 
 } // namespace sakura
@@ -2,6 +2,7 @@
 
 #include <QByteArray>
 #include <QDomDocument>
+#include <QIODevice>
 #include <QList>
 #include <QMap>
 #include <QObject>
@@ -71,6 +72,11 @@ public:
     QList<PartitionInfo> readPartitions();
     bool writePartition(const QString& name, const QByteArray& data);
     QByteArray readPartition(const QString& name, qint64 offset = 0, qint64 length = -1);
+    // Streaming variants: the data phase runs from/to the device with a
+    // fixed double buffer. `size` < 0 writes to the end of `source`.
+    bool writePartition(const QString& name, QIODevice* source, qint64 size = -1);
+    bool readPartition(const QString& name, QIODevice* sink,
+                       qint64 offset = 0, qint64 length = -1);
     bool erasePartition(const QString& name);
     bool formatPartition(const QString& name);
 
@@ -96,9 +102,16 @@ private:
     bool isResponseOk(const QDomDocument& doc) const;
     QString getResponseField(const QDomDocument& doc, const QString& field) const;
 
+    // Command phase of a partition write/read; beginRead returns the
+    // byte count the DA is about to send, or -1
+    bool beginWrite(const QString& name, qint64 size);
+    qint64 beginRead(const QString& name, qint64 offset, qint64 length);
+
     // Data transfer (binary payload follows XML handshake)
     bool sendBinaryPayload(const QByteArray& data);
+    bool sendBinaryPayload(QIODevice* source, qint64 size);
     QByteArray recvBinaryPayload(qint64 expectedSize);
+    bool recvBinaryPayload(QIODevice* sink, qint64 expectedSize);
 
     ITransport* m_transport = nullptr;
     static constexpr int DEFAULT_TIMEOUT = 10000;
@@ -6,6 +6,11 @@
 #include "transport/i_transport.h"
 #include "core/logger.h"
 
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+
 namespace sakura {
 
 static constexpr char LOG_TAG[] = "MTK-SVC";
@@ -144,6 +149,28 @@ QByteArray MediatekService::readPartition(const QString& name, qint64 offset, qi
     return {};
 }
 
+bool MediatekService::writePartition(const QString& name, QIODevice* source, qint64 size)
+{
+    if (m_xflashClient)
+        return m_xflashClient->writePartition(name, source, size);
+    if (m_xmlDaClient)
+        return m_xmlDaClient->writePartition(name, source, size);
+
+    emit operationCompleted(false, "No DA client active");
+    return false;
+}
+
+bool MediatekService::readPartition(const QString& name, QIODevice* sink, qint64 offset, qint64 length)
+{
+    if (m_xflashClient)
+        return m_xflashClient->readPartition(name, sink, offset, length);
+    if (m_xmlDaClient)
+        return m_xmlDaClient->readPartition(name, sink, offset, length);
+
+    emit operationCompleted(false, "No DA client active");
+    return false;
+}
+
 bool MediatekService::erasePartition(const QString& name)
 {
     if (m_xflashClient)
@@ -183,6 +210,135 @@ bool MediatekService::formatAll()
     return fail == 0;
 }
 
+// ── Backup ──────────────────────────────────────────────────────────────────
+
+bool MediatekService::backupPartitions(const QStringList& names, const QString& dir,
+                                       const BackupCallback& onPartition)
+{
+    if (!m_xflashClient && !m_xmlDaClient) {
+        emit operationCompleted(false, "No DA client active");
+        return false;
+    }
+    if (!QDir().mkpath(dir)) {
+        LOG_ERROR_CAT(LOG_TAG, QString("Cannot create backup directory %1").arg(dir));
+        return false;
+    }
+
+    // The GPT gives the sizes for the scatter layout and for progress
+    const QList<PartitionInfo> layout = readPartitions();
+    bool ufs = false;
+    if (m_xflashClient)
+        ufs = m_xflashClient->getDaInfo().flashType == 2;
+    else
+        ufs = m_xmlDaClient->getDaInfo().flashType == 2;
+
+    QStringList saved;
+    qint64 totalBytes = 0, totalMs = 0;
+    for (int i = 0; i < names.size(); ++i) {
+        MtkBackupEntry entry;
+        entry.name = names[i];
+        entry.filePath = QDir(dir).filePath(entry.name + ".bin");
+
+        QFile out(entry.filePath);
+        QElapsedTimer timer;
+        timer.start();
+        if (out.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+            entry.ok = readPartition(entry.name, &out);
+            entry.bytes = out.size();
+            out.close();
+            if (!entry.ok)
+                out.remove();
+        } else {
+            LOG_ERROR_CAT(LOG_TAG, QString("Cannot create %1: %2")
+                                       .arg(entry.filePath, out.errorString()));
+        }
+        entry.elapsedMs = timer.elapsed();
+
+        if (entry.ok) {
+            saved.append(entry.name);
+            totalBytes += entry.bytes;
+            totalMs += entry.elapsedMs;
+            LOG_INFO_CAT(LOG_TAG, QString("Backup %1: %2 bytes in %3 ms (%4 MiB/s)")
+                                      .arg(entry.name).arg(entry.bytes).arg(entry.elapsedMs)
+                                      .arg(entry.bytes / 1048576.0 / qMax<qint64>(entry.elapsedMs, 1) * 1000.0,
+                                           0, 'f', 1));
+        }
+        if (onPartition)
+            onPartition(i, entry);
+    }
+
+    if (!layout.isEmpty() && !saved.isEmpty()) {
+        const MtkChipDatabase& chips = MtkChipDatabase::instance();
+        const QString platform = chips.isKnownChip(m_deviceInfo.hwCode)
+            ? chips.chipName(m_deviceInfo.hwCode) : QString("MTK");
+        QString scatter = QDir(dir).filePath(
+            QString("%1_Android_scatter.txt").arg(QString(platform).replace(' ', '_')));
+        // Never replace a firmware package's own scatter with a backup layout
+        if (QFileInfo::exists(scatter))
+            LOG_WARNING_CAT(LOG_TAG, QString("Scatter file not written, %1 already exists").arg(scatter));
+        else if (!writeScatterFile(scatter, layout, saved, platform, ufs))
+            LOG_WARNING_CAT(LOG_TAG, "Scatter file not written");
+    }
+
+    LOG_INFO_CAT(LOG_TAG, QString("Backup: %1/%2 partitions, %3 bytes in %4 ms")
+                              .arg(saved.size()).arg(names.size()).arg(totalBytes).arg(totalMs));
+    return saved.size() == names.size();
+}
+
+bool MediatekService::writeScatterFile(const QString& path, const QList<PartitionInfo>& layout,
+                                       const QStringList& backedUp, const QString& platform,
+                                       bool ufs)
+{
+    QFile f(path);
+    if (!f.open(QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Text)) {
+        LOG_ERROR_CAT(LOG_TAG, QString("Cannot create %1: %2").arg(path, f.errorString()));
+        return false;
+    }
+
+    const QString storage = ufs ? "UFS" : "EMMC";
+    const QString region  = ufs ? "UFS_LU2" : "EMMC_USER";
+    const QString rule(108, '#');
+
+    QString text;
+    text += rule + "\n#\n#  General Setting\n#\n" + rule + "\n";
+    text += "- general: MTK_PLATFORM_CFG\n  info:\n";
+    text += "    - config_version: V1.1.2\n";
+    text += QString("      platform: %1\n").arg(platform);
+    text += "      project: backup\n";
+    text += QString("      storage: %1\n").arg(storage);
+    text += "      boot_channel: MSDC_0\n";
+    text += "      block_size: 0x20000\n";
+    text += rule + "\n#\n#  Layout Setting\n#\n" + rule + "\n";
+
+    for (int i = 0; i < layout.size(); ++i) {
+        const PartitionInfo& p = layout[i];
+        const bool saved = backedUp.contains(p.name);
+        const uint64_t sectorSize = p.numSectors ? p.sizeBytes / p.numSectors : 512;
+        const uint64_t start = p.startSector * sectorSize;
+        text += QString("- partition_index: SYS%1\n").arg(i);
+        text += QString("  partition_name: %1\n").arg(p.name);
+        text += QString("  file_name: %1\n").arg(saved ? p.name + ".bin" : QString("NONE"));
+        text += QString("  is_download: %1\n").arg(saved ? "true" : "false");
+        text += "  type: NORMAL_ROM\n";
+        text += QString("  linear_start_addr: 0x%1\n").arg(start, 0, 16);
+        text += QString("  physical_start_addr: 0x%1\n").arg(start, 0, 16);
+        text += QString("  partition_size: 0x%1\n").arg(p.sizeBytes, 0, 16);
+        text += QString("  region: %1\n").arg(region);
+        text += QString("  storage: HW_STORAGE_%1\n").arg(storage);
+        text += "  boundary_check: true\n";
+        text += "  is_reserved: false\n";
+        text += QString("  operation_type: %1\n").arg(saved ? "UPDATE" : "INVISIBLE");
+        text += "  is_upgradable: true\n";
+        text += "  empty_boot_needed: false\n";
+        text += "  reserve: 0x00\n\n";
+    }
+
+    f.write(text.toUtf8());
+    f.close();
+    LOG_INFO_CAT(LOG_TAG, QString("Scatter written: %1").arg(path));
+    return true;
+}
+
 // ── Device info ─────────────────────────────────────────────────────────────
 
 QString MediatekService::chipName() const
@@ -1,10 +1,13 @@
 #pragma once
 
 #include <QByteArray>
+#include <QIODevice>
 #include <QList>
 #include <QMap>
 #include <QObject>
 #include <QString>
+#include <QStringList>
+#include <functional>
 #include <memory>
 
 #include "common/partition_info.h"
@@ -27,6 +30,16 @@ enum class MtkDaProtocol {
     XmlDa       // XML DA V6 protocol
 };
 
+// ── Backup result for one partition ─────────────────────────────────────────
+
+struct MtkBackupEntry {
+    QString name;
+    QString filePath;
+    qint64  bytes     = 0;
+    qint64  elapsedMs = 0;
+    bool    ok        = false;
+};
+
 // ── MediaTek service — orchestrates the full flash flow ─────────────────────
 
 class MediatekService : public QObject {
@@ -53,9 +66,22 @@ public:
     QList<PartitionInfo> readPartitions();
     bool writePartition(const QString& name, const QByteArray& data);
     QByteArray readPartition(const QString& name, qint64 offset = 0, qint64 length = -1);
+    // Streaming variants for partitions too large to hold in memory
+    bool writePartition(const QString& name, QIODevice* source, qint64 size = -1);
+    bool readPartition(const QString& name, QIODevice* sink, qint64 offset = 0, qint64 length = -1);
     bool erasePartition(const QString& name);
     bool formatAll();
 
+    // Backup: streams each partition to <dir>/<name>.bin and writes a
+    // scatter file describing the device layout next to them. `onPartition`
+    // is called after every partition (from the calling thread).
+    using BackupCallback = std::function<void(int index, const MtkBackupEntry& entry)>;
+    bool backupPartitions(const QStringList& names, const QString& dir,
+                          const BackupCallback& onPartition = nullptr);
+    static bool writeScatterFile(const QString& path, const QList<PartitionInfo>& layout,
+                                 const QStringList& backedUp, const QString& platform,
+                                 bool ufs);
+
     // Device info
     MtkDeviceInfo deviceInfo() const { return m_deviceInfo; }
     QString chipName() const;
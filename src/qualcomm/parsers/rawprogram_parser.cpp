@@ -45,6 +45,7 @@ RawprogramParseResult RawprogramParser::parseRawprogramXml(const QByteArray& xml
             entry.filename       = attrs.value("filename").toString();
             entry.label          = attrs.value("label").toString();
             entry.startSector    = attrs.value("start_sector").toULongLong();
+            entry.startSectorExpr = attrs.value("start_sector").toString();
             entry.numSectors     = attrs.value("num_partition_sectors").toULongLong();
             entry.sectorSize     = attrs.value("SECTOR_SIZE_IN_BYTES").toUInt();
             entry.physicalPartition = attrs.value("physical_partition_number").toUInt();
@@ -65,6 +66,7 @@ RawprogramParseResult RawprogramParser::parseRawprogramXml(const QByteArray& xml
             auto attrs = reader.attributes();
 
             patch.sectorOffset      = attrs.value("sector_offset").toULongLong();
+            patch.sectorOffsetExpr  = attrs.value("sector_offset").toString();
             patch.byteOffset        = attrs.value("byte_offset").toUInt();
             patch.sizeInBytes       = attrs.value("size_in_bytes").toUInt();
             patch.value             = attrs.value("value").toString();
@@ -111,6 +113,7 @@ QList<PatchEntry> RawprogramParser::parsePatchXml(const QByteArray& xmlData)
             auto attrs = reader.attributes();
 
             patch.sectorOffset      = attrs.value("sector_offset").toULongLong();
+            patch.sectorOffsetExpr  = attrs.value("sector_offset").toString();
             patch.byteOffset        = attrs.value("byte_offset").toUInt();
             patch.sizeInBytes       = attrs.value("size_in_bytes").toUInt();
             patch.value             = attrs.value("value").toString();
@@ -159,7 +162,8 @@ QString RawprogramParser::generateRawprogramXml(const QList<RawprogramEntry>& en
         w.writeAttribute("label", e.label);
         w.writeAttribute("num_partition_sectors", QString::number(e.numSectors));
         w.writeAttribute("physical_partition_number", QString::number(e.physicalPartition));
-        w.writeAttribute("start_sector", QString::number(e.startSector));
+        w.writeAttribute("start_sector", e.startSectorExpr.isEmpty()
+                                             ? QString::number(e.startSector) : e.startSectorExpr);
         if (e.sparse)
             w.writeAttribute("sparse", "true");
         if (e.readbackVerify)
@@ -185,7 +189,8 @@ QString RawprogramParser::generatePatchXml(const QList<PatchEntry>& patches)
         w.writeAttribute("byte_offset", QString::number(p.byteOffset));
         w.writeAttribute("filename", p.filename);
         w.writeAttribute("physical_partition_number", QString::number(p.physicalPartition));
-        w.writeAttribute("sector_offset", QString::number(p.sectorOffset));
+        w.writeAttribute("sector_offset", p.sectorOffsetExpr.isEmpty()
+                                              ? QString::number(p.sectorOffset) : p.sectorOffsetExpr);
         w.writeAttribute("size_in_bytes", QString::number(p.sizeInBytes));
         w.writeAttribute("value", p.value);
         w.writeEndElement();
@@ -17,11 +17,13 @@ struct RawprogramEntry {
     bool     readbackVerify = false;
     bool     sparse = false;      // Sparse image
     QString  startByteHex;        // Original hex for start_byte_hex
+    QString  startSectorExpr;     // Original start_sector, e.g. "NUM_DISK_SECTORS-5."
 };
 
 // ─── Patch XML entry ─────────────────────────────────────────────────
 struct PatchEntry {
     uint64_t sectorOffset = 0;
+    QString  sectorOffsetExpr;     // Original sector_offset (may be relative to disk end)
     uint32_t byteOffset = 0;
     uint32_t sizeInBytes = 0;
     QString  value;
@@ -2,8 +2,10 @@
 #include "transport/i_transport.h"
 #include "core/logger.h"
 #include "common/gpt_parser.h"
+#include "common/sparse_stream.h"
 
 #include <QBuffer>
+#include <QElapsedTimer>
 #include <QXmlStreamReader>
 #include <QXmlStreamWriter>
 #include <cstring>
@@ -75,6 +77,13 @@ QString FirehoseClient::buildReadXml(uint64_t startSector, uint64_t numSectors,
 QString FirehoseClient::buildProgramXml(uint64_t startSector, uint64_t numSectors,
                                          uint32_t sectorSize, uint32_t lun,
                                          const QString& filename)
+{
+    return buildProgramXml(QString::number(startSector), numSectors, sectorSize, lun, filename);
+}
+
+QString FirehoseClient::buildProgramXml(const QString& startSector, uint64_t numSectors,
+                                         uint32_t sectorSize, uint32_t lun,
+                                         const QString& filename)
 {
     QString xml;
     QXmlStreamWriter w(&xml);
@@ -84,7 +93,7 @@ QString FirehoseClient::buildProgramXml(uint64_t startSector, uint64_t numSector
     w.writeAttribute("SECTOR_SIZE_IN_BYTES", QString::number(sectorSize));
     w.writeAttribute("num_partition_sectors", QString::number(numSectors));
     w.writeAttribute("physical_partition_number", QString::number(lun));
-    w.writeAttribute("start_sector", QString::number(startSector));
+    w.writeAttribute("start_sector", startSector);
     if (!filename.isEmpty())
         w.writeAttribute("filename", filename);
     w.writeEndElement();
@@ -111,7 +120,7 @@ QString FirehoseClient::buildEraseXml(uint64_t startSector, uint64_t numSectors,
     return xml;
 }
 
-QString FirehoseClient::buildPatchXml(uint64_t sectorOffset, uint32_t byteOffset,
+QString FirehoseClient::buildPatchXml(const QString& sectorOffset, uint32_t byteOffset,
                                        uint32_t size, const QString& value, uint32_t lun)
 {
     QString xml;
@@ -123,7 +132,7 @@ QString FirehoseClient::buildPatchXml(uint64_t sectorOffset, uint32_t byteOffset
     w.writeAttribute("byte_offset", QString::number(byteOffset));
     w.writeAttribute("filename", "DISK");
     w.writeAttribute("physical_partition_number", QString::number(lun));
-    w.writeAttribute("sector_offset", QString::number(sectorOffset));
+    w.writeAttribute("sector_offset", sectorOffset);
     w.writeAttribute("size_in_bytes", QString::number(size));
     w.writeAttribute("value", value);
     w.writeEndElement();
@@ -264,6 +273,73 @@ FirehoseResponse FirehoseClient::parseResponse(const QByteArray& data)
     return result;
 }
 
+// Collects at least `minCount` <response> elements. A single bulk read may
+// carry more than one, so the number actually consumed is returned (or -1
+// on timeout) and the caller adjusts its outstanding-command count. Bytes
+// after the last complete tag are kept in m_ackTail for the next call.
+int FirehoseClient::receiveAcks(int minCount, bool& allAck, int timeoutMs)
+{
+    QByteArray accumulated = std::move(m_ackTail);
+    m_ackTail.clear();
+    int found = 0;
+    int scanFrom = 0;
+    QElapsedTimer timer;
+    timer.start();
+
+    while (found < minCount) {
+        if (timer.elapsed() >= timeoutMs)
+            return -1;
+
+        QByteArray chunk = m_transport->read(m_maxPayloadSize, 100);
+        if (chunk.isEmpty())
+            continue;
+        accumulated.append(chunk);
+
+        // Scan complete tags only; a tag split across reads is picked
+        // up on the next pass (or the next call, via m_ackTail)
+        for (;;) {
+            int tagStart = accumulated.indexOf('<', scanFrom);
+            if (tagStart < 0)
+                break;
+            int tagEnd = accumulated.indexOf('>', tagStart);
+            if (tagEnd < 0)
+                break;
+            scanFrom = tagEnd + 1;
+
+            QByteArray tag = accumulated.mid(tagStart, tagEnd - tagStart + 1);
+            if (!tag.startsWith("<response") && !tag.startsWith("<log"))
+                continue;
+
+            QByteArray value;
+            int v = tag.indexOf("value=\"");
+            if (v >= 0) {
+                v += 7;
+                int q = tag.indexOf('"', v);
+                if (q > v) value = tag.mid(v, q - v);
+            }
+
+            if (tag.startsWith("<log")) {
+                if (!value.isEmpty()) {
+                    LOG_DEBUG_CAT(TAG, QString("[Device] %1").arg(QString::fromUtf8(value)));
+                    emit logMessage(QString::fromUtf8(value));
+                }
+                continue;
+            }
+
+            ++found;
+            if (qstricmp(value.constData(), "ACK") != 0) {
+                allAck = false;
+                LOG_WARNING_CAT(TAG, QString("Device responded %1")
+                                         .arg(QString::fromUtf8(value)));
+            }
+        }
+    }
+    int tailStart = accumulated.indexOf('<', scanFrom);
+    if (tailStart >= 0)
+        m_ackTail = accumulated.mid(tailStart);
+    return found;
+}
+
 // ─── Configure ───────────────────────────────────────────────────────
 
 bool FirehoseClient::configure(FirehoseStorageType storage,
@@ -275,6 +351,7 @@ bool FirehoseClient::configure(FirehoseStorageType storage,
 
     m_storageType = storage;
     m_maxPayloadSize = maxPayloadSize;
+    m_partitionCache.clear();
 
     // Set sector size based on storage type
     m_sectorSize = (storage == FirehoseStorageType::UFS) ? 4096 : 512;
@@ -356,78 +433,100 @@ QList<PartitionInfo> FirehoseClient::readGptPartitions(uint32_t lun)
         return {};
     }
 
+    LunPartitionMap map;
+    map.partitions = result.partitions;
+    map.firstUsableLba = result.header.firstUsableLba;
+    map.lastUsableLba = result.header.lastUsableLba;
+    // First match wins on duplicate names, as with a linear search
+    for (int i = 0; i < map.partitions.size(); ++i) {
+        const QString key = map.partitions[i].name.toLower();
+        if (!map.indexByName.contains(key))
+            map.indexByName.insert(key, i);
+    }
+    m_partitionCache.insert(lun, map);
+
     LOG_INFO_CAT(TAG, QString("Found %1 partitions on LUN %2")
                     .arg(result.partitions.size()).arg(lun));
     return result.partitions;
 }
 
+// ─── Partition map cache ─────────────────────────────────────────────
+
+bool FirehoseClient::findPartition(const QString& name, uint32_t lun, PartitionInfo& out)
+{
+    if (!m_partitionCache.contains(lun) && readGptPartitions(lun).isEmpty())
+        return false;
+
+    const LunPartitionMap& map = m_partitionCache[lun];
+    auto it = map.indexByName.constFind(name.toLower());
+    if (it == map.indexByName.constEnd())
+        return false;
+
+    out = map.partitions[it.value()];
+    return true;
+}
+
+void FirehoseClient::invalidatePartitionCache()
+{
+    m_partitionCache.clear();
+}
+
+void FirehoseClient::invalidatePartitionCache(uint32_t lun)
+{
+    m_partitionCache.remove(lun);
+}
+
+void FirehoseClient::invalidateIfTouchesGpt(uint64_t startSector, uint64_t numSectors,
+                                             uint32_t lun)
+{
+    auto it = m_partitionCache.constFind(lun);
+    if (it == m_partitionCache.constEnd())
+        return;
+
+    // Primary GPT sits below firstUsableLba, the backup above lastUsableLba
+    uint64_t endSector = startSector + numSectors;
+    if (startSector < it->firstUsableLba || endSector > it->lastUsableLba + 1) {
+        LOG_DEBUG_CAT(TAG, QString("Write touches GPT on LUN %1, dropping cached map").arg(lun));
+        m_partitionCache.remove(lun);
+    }
+}
+
 // ─── Read partition ──────────────────────────────────────────────────
 
 QByteArray FirehoseClient::readPartition(const QString& name, uint32_t lun,
                                           ProgressCallback progress)
+{
+    QByteArray result;
+    QBuffer buffer(&result);
+    if (!buffer.open(QIODevice::WriteOnly))
+        return {};
+    if (!readPartition(name, &buffer, lun, progress))
+        return {};
+    return result;
+}
+
+bool FirehoseClient::readPartition(const QString& name, QIODevice* sink, uint32_t lun,
+                                    ProgressCallback progress)
 {
     LOG_INFO_CAT(TAG, QString("Reading partition '%1' from LUN %2").arg(name).arg(lun));
 
-    // First read GPT to find the partition
-    auto partitions = readGptPartitions(lun);
-    const PartitionInfo* target = nullptr;
-    for (const auto& p : partitions) {
-        if (p.name.compare(name, Qt::CaseInsensitive) == 0) {
-            target = &p;
-            break;
-        }
+    if (!sink || !sink->isWritable()) {
+        LOG_ERROR_CAT(TAG, QString("Sink for '%1' is not writable").arg(name));
+        return false;
     }
 
-    if (!target) {
+    PartitionInfo target;
+    if (!findPartition(name, lun, target)) {
         LOG_ERROR_CAT(TAG, QString("Partition '%1' not found").arg(name));
-        return {};
+        return false;
     }
 
-    qint64 totalSectors = target->numSectors;
-    qint64 totalBytes = totalSectors * m_sectorSize;
-    qint64 readSoFar = 0;
-    QByteArray result;
-    result.reserve(totalBytes);
-
-    uint32_t chunkSectors = m_maxPayloadSize / m_sectorSize;
-
-    for (qint64 sector = 0; sector < totalSectors; sector += chunkSectors) {
-        uint32_t count = qMin(static_cast<qint64>(chunkSectors), totalSectors - sector);
-        uint64_t startSector = target->startSector + sector;
-
-        QString xml = buildReadXml(startSector, count, m_sectorSize, lun);
-        if (!sendXmlCommand(xml)) {
-            LOG_ERROR_CAT(TAG, "Failed to send read command");
-            return {};
-        }
-
-        uint32_t expectedBytes = count * m_sectorSize;
-        QByteArray chunk = m_transport->readExact(expectedBytes, DATA_TIMEOUT_MS);
-        if (chunk.size() != static_cast<int>(expectedBytes)) {
-            LOG_WARNING_CAT(TAG, QString("readPartition: expected %1 bytes, got %2")
-                                     .arg(expectedBytes).arg(chunk.size()));
-            if (chunk.isEmpty()) {
-                LOG_ERROR_CAT(TAG, "No data received, aborting read");
-                return {};
-            }
-        }
-        result.append(chunk);
-        readSoFar += chunk.size();
-
-        // Wait for ACK
-        FirehoseResponse ackResp = receiveXmlResponse(XML_TIMEOUT_MS);
-        if (!ackResp.success) {
-            LOG_WARNING_CAT(TAG, QString("Read chunk NAK at sector %1: %2")
-                                     .arg(startSector).arg(ackResp.rawValue));
-        }
-
-        if (progress)
-            progress(readSoFar, totalBytes);
-        emit transferProgress(readSoFar, totalBytes);
-    }
+    if (!readRange(target.startSector, target.numSectors, lun, sink, progress))
+        return false;
 
-    LOG_INFO_CAT(TAG, QString("Read %1 bytes from '%2'").arg(result.size()).arg(name));
-    return result;
+    LOG_INFO_CAT(TAG, QString("Read %1 bytes from '%2'")
+                    .arg(target.numSectors * m_sectorSize).arg(name));
+    return true;
 }
 
 // ─── Write partition ─────────────────────────────────────────────────
@@ -435,117 +534,258 @@ QByteArray FirehoseClient::readPartition(const QString& name, uint32_t lun,
 bool FirehoseClient::writePartition(const QString& name, const QByteArray& data,
                                      uint32_t lun, ProgressCallback progress)
 {
-    LOG_INFO_CAT(TAG, QString("Writing %1 bytes to partition '%2' on LUN %3")
-                    .arg(data.size()).arg(name).arg(lun));
-
-    // Find partition in GPT
-    auto partitions = readGptPartitions(lun);
-    const PartitionInfo* target = nullptr;
-    for (const auto& p : partitions) {
-        if (p.name.compare(name, Qt::CaseInsensitive) == 0) {
-            target = &p;
-            break;
-        }
+    QBuffer buffer;
+    buffer.setData(data);
+    if (!buffer.open(QIODevice::ReadOnly))
+        return false;
+    return writePartition(name, &buffer, lun, progress);
+}
+
+bool FirehoseClient::writePartition(const QString& name, QIODevice* source,
+                                     uint32_t lun, ProgressCallback progress)
+{
+    if (!source || !source->isReadable()) {
+        LOG_ERROR_CAT(TAG, QString("Source for '%1' is not readable").arg(name));
+        return false;
     }
 
-    if (!target) {
+    const qint64 totalBytes = source->size() - source->pos();
+    LOG_INFO_CAT(TAG, QString("Writing %1 bytes to partition '%2' on LUN %3")
+                    .arg(totalBytes).arg(name).arg(lun));
+
+    PartitionInfo target;
+    if (!findPartition(name, lun, target)) {
         LOG_ERROR_CAT(TAG, QString("Partition '%1' not found").arg(name));
         return false;
     }
 
     // Calculate sectors needed
-    uint64_t numSectors = (data.size() + m_sectorSize - 1) / m_sectorSize;
-    if (numSectors > target->numSectors) {
+    uint64_t numSectors = (totalBytes + m_sectorSize - 1) / m_sectorSize;
+    if (numSectors > target.numSectors) {
         LOG_ERROR_CAT(TAG, QString("Data too large: %1 sectors needed, %2 available")
-                        .arg(numSectors).arg(target->numSectors));
+                        .arg(numSectors).arg(target.numSectors));
+        return false;
+    }
+
+    if (!programRange(target.startSector, numSectors, lun, source, totalBytes,
+                      withSignal(progress)))
+        return false;
+
+    LOG_INFO_CAT(TAG, QString("Write to '%1' complete").arg(name));
+    return true;
+}
+
+// ─── Erase partition ─────────────────────────────────────────────────
+
+bool FirehoseClient::erasePartition(const QString& name, uint32_t lun)
+{
+    LOG_INFO_CAT(TAG, QString("Erasing partition '%1' on LUN %2").arg(name).arg(lun));
+
+    PartitionInfo target;
+    if (!findPartition(name, lun, target)) {
+        LOG_ERROR_CAT(TAG, QString("Partition '%1' not found for erase").arg(name));
+        return false;
+    }
+
+    invalidateIfTouchesGpt(target.startSector, target.numSectors, lun);
+    QString xml = buildEraseXml(target.startSector, target.numSectors, m_sectorSize, lun);
+    if (!sendXmlCommand(xml))
+        return false;
+
+    FirehoseResponse resp = receiveXmlResponse(DATA_TIMEOUT_MS);
+    if (!resp.success) {
+        LOG_ERROR_CAT(TAG, QString("Erase failed: %1").arg(resp.rawValue));
         return false;
     }
 
-    qint64 totalBytes = data.size();
-    qint64 written = 0;
-    uint32_t chunkSectors = m_maxPayloadSize / m_sectorSize;
+    LOG_INFO_CAT(TAG, QString("Partition '%1' erased").arg(name));
+    return true;
+}
 
-    for (uint64_t sector = 0; sector < numSectors; sector += chunkSectors) {
-        uint32_t count = qMin(static_cast<uint64_t>(chunkSectors), numSectors - sector);
-        uint64_t startSector = target->startSector + sector;
+// ─── Sector-addressed operations ─────────────────────────────────────
 
-        // Send program command
-        QString xml = buildProgramXml(startSector, count, m_sectorSize, lun);
-        if (!sendXmlCommand(xml)) {
-            LOG_ERROR_CAT(TAG, "Failed to send program command");
-            return false;
+bool FirehoseClient::programSectors(uint64_t startSector, uint64_t numSectors, uint32_t lun,
+                                     QIODevice* source, qint64 dataBytes,
+                                     ProgressCallback progress)
+{
+    if (!source || !source->isReadable())
+        return false;
+
+    LOG_INFO_CAT(TAG, QString("Programming %1 sectors at LBA %2 on LUN %3")
+                    .arg(numSectors).arg(startSector).arg(lun));
+    return programRange(startSector, numSectors, lun, source, dataBytes, withSignal(progress));
+}
+
+bool FirehoseClient::programSectors(const QString& startSectorExpr, uint64_t numSectors,
+                                     uint32_t lun, QIODevice* source, qint64 dataBytes,
+                                     ProgressCallback progress)
+{
+    bool numeric = false;
+    uint64_t start = startSectorExpr.toULongLong(&numeric);
+    if (numeric)
+        return programSectors(start, numSectors, lun, source, dataBytes, progress);
+
+    if (!source || !source->isReadable())
+        return false;
+
+    LOG_INFO_CAT(TAG, QString("Programming %1 sectors at '%2' on LUN %3")
+                    .arg(numSectors).arg(startSectorExpr).arg(lun));
+    return programRange(0, numSectors, lun, source, dataBytes, withSignal(progress),
+                        startSectorExpr);
+}
+
+bool FirehoseClient::programSparse(uint64_t startSector, uint32_t lun, QIODevice* sparseSource,
+                                    bool eraseDontCare, ProgressCallback progress)
+{
+    if (!sparseSource || !sparseSource->isReadable())
+        return false;
+
+    auto readExactly = [sparseSource](void* dst, qint64 len) {
+        return sparseSource->read(static_cast<char*>(dst), len) == len;
+    };
+    auto skip = [sparseSource](qint64 len) {
+        char scratch[64];
+        while (len > 0) {
+            qint64 n = sparseSource->read(scratch, qMin<qint64>(len, sizeof(scratch)));
+            if (n <= 0) return false;
+            len -= n;
         }
+        return true;
+    };
+
+    SparseHeader hdr;
+    if (!readExactly(&hdr, sizeof(hdr)) || hdr.magic != SPARSE_HEADER_MAGIC
+        || hdr.fileHeaderSize < sizeof(SparseHeader)
+        || hdr.chunkHeaderSize < sizeof(SparseChunkHeader)
+        || !skip(hdr.fileHeaderSize - sizeof(SparseHeader))) {
+        LOG_ERROR_CAT(TAG, "programSparse: not a sparse image");
+        return false;
+    }
+    if (hdr.blockSize == 0 || hdr.blockSize % m_sectorSize != 0) {
+        LOG_ERROR_CAT(TAG, QString("programSparse: block size %1 is not a multiple of sector size %2")
+                               .arg(hdr.blockSize).arg(m_sectorSize));
+        return false;
+    }
 
-        // Send the data chunk
-        qint64 offset = static_cast<qint64>(sector) * m_sectorSize;
-        uint32_t chunkSize = count * m_sectorSize;
-        if (offset > data.size()) {
-            LOG_ERROR_CAT(TAG, QString("Write offset %1 exceeds data size %2")
-                                   .arg(offset).arg(data.size()));
+    const qint64 rawTotal = static_cast<qint64>(hdr.totalBlocks) * hdr.blockSize;
+    const uint64_t sectorsPerBlock = hdr.blockSize / m_sectorSize;
+    qint64 rawDone = 0;
+    qint64 wireBytes = 0;
+
+    auto advance = [&](qint64 bytes) {
+        rawDone += bytes;
+        if (progress)
+            progress(rawDone, rawTotal);
+        emit transferProgress(rawDone, rawTotal);
+    };
+
+    uint64_t block = 0;
+    for (uint32_t i = 0; i < hdr.totalChunks; ++i) {
+        SparseChunkHeader chdr;
+        if (!readExactly(&chdr, sizeof(chdr)) || !skip(hdr.chunkHeaderSize - sizeof(chdr))) {
+            LOG_ERROR_CAT(TAG, QString("programSparse: truncated chunk header %1").arg(i));
             return false;
         }
-        QByteArray chunk = data.mid(offset, chunkSize);
 
-        // Pad to sector alignment
-        if (static_cast<uint32_t>(chunk.size()) < chunkSize) {
-            chunk.resize(chunkSize, '\0');
+        // Validate the header before anything reaches the device: a chunk
+        // may not run past the image (and so past the rawprogram entry),
+        // and its size must match its type or the stream desyncs
+        if (chdr.chunkBlocks > hdr.totalBlocks - block) {
+            LOG_ERROR_CAT(TAG, QString("programSparse: chunk %1 runs past the image (%2 + %3 > %4 blocks)")
+                                   .arg(i).arg(block).arg(chdr.chunkBlocks).arg(hdr.totalBlocks));
+            return false;
         }
-
-        if (m_transport->write(chunk) != chunk.size()) {
-            LOG_ERROR_CAT(TAG, "Failed to write data chunk");
+        qint64 payloadSize = -1;
+        switch (chdr.chunkType) {
+        case CHUNK_TYPE_RAW:       payloadSize = static_cast<qint64>(chdr.chunkBlocks) * hdr.blockSize; break;
+        case CHUNK_TYPE_FILL:      payloadSize = 4; break;
+        case CHUNK_TYPE_DONT_CARE: payloadSize = 0; break;
+        case CHUNK_TYPE_CRC32:     payloadSize = 4; break;
+        default: break;
+        }
+        if (payloadSize >= 0 && static_cast<qint64>(chdr.totalSize) != hdr.chunkHeaderSize + payloadSize) {
+            LOG_ERROR_CAT(TAG, QString("programSparse: chunk %1 size %2 does not match its type (expected %3)")
+                                   .arg(i).arg(chdr.totalSize).arg(hdr.chunkHeaderSize + payloadSize));
             return false;
         }
 
-        written += qMin(static_cast<qint64>(chunkSize), totalBytes - offset);
-
-        // Wait for ACK
-        FirehoseResponse resp = receiveXmlResponse(DATA_TIMEOUT_MS);
-        if (!resp.success) {
-            LOG_ERROR_CAT(TAG, QString("Write NAK at sector %1: %2")
-                            .arg(startSector).arg(resp.rawValue));
+        const uint64_t chunkSector = startSector + block * sectorsPerBlock;
+        const uint64_t chunkSectors = static_cast<uint64_t>(chdr.chunkBlocks) * sectorsPerBlock;
+        const qint64 chunkBytes = static_cast<qint64>(chdr.chunkBlocks) * hdr.blockSize;
+
+        switch (chdr.chunkType) {
+        case CHUNK_TYPE_RAW: {
+            const qint64 base = rawDone;
+            bool ok = programRange(chunkSector, chunkSectors, lun, sparseSource, chunkBytes,
+                [&](qint64 c, qint64) {
+                    rawDone = base + c;
+                    if (progress)
+                        progress(rawDone, rawTotal);
+                    emit transferProgress(rawDone, rawTotal);
+                });
+            if (!ok)
+                return false;
+            wireBytes += chunkBytes;
+            break;
+        }
+        case CHUNK_TYPE_FILL: {
+            uint32_t fillValue = 0;
+            if (!readExactly(&fillValue, 4))
+                return false;
+            if (!programFill(chunkSector, chunkSectors, lun, fillValue, advance))
+                return false;
+            wireBytes += chunkBytes;
+            break;
+        }
+        case CHUNK_TYPE_DONT_CARE:
+            if (eraseDontCare) {
+                invalidateIfTouchesGpt(chunkSector, chunkSectors, lun);
+                QString xml = buildEraseXml(chunkSector, chunkSectors, m_sectorSize, lun);
+                if (!sendXmlCommand(xml) || !receiveXmlResponse(DATA_TIMEOUT_MS).success) {
+                    LOG_ERROR_CAT(TAG, QString("Erase of DONT_CARE range at sector %1 failed")
+                                           .arg(chunkSector));
+                    return false;
+                }
+            }
+            advance(chunkBytes);
+            break;
+        case CHUNK_TYPE_CRC32:
+            if (!skip(chdr.totalSize - hdr.chunkHeaderSize))
+                return false;
+            break;
+        default:
+            LOG_ERROR_CAT(TAG, QString("programSparse: unknown chunk type 0x%1")
+                                   .arg(chdr.chunkType, 4, 16, QChar('0')));
             return false;
         }
 
-        if (progress)
-            progress(written, totalBytes);
-        emit transferProgress(written, totalBytes);
+        block += chdr.chunkBlocks;
     }
 
-    LOG_INFO_CAT(TAG, QString("Write to '%1' complete").arg(name));
+    LOG_INFO_CAT(TAG, QString("Sparse write: %1 of %2 bytes sent over USB (%3% skipped)")
+                    .arg(wireBytes).arg(rawTotal)
+                    .arg(rawTotal ? 100 - wireBytes * 100 / rawTotal : 0));
     return true;
 }
 
-// ─── Erase partition ─────────────────────────────────────────────────
-
-bool FirehoseClient::erasePartition(const QString& name, uint32_t lun)
+bool FirehoseClient::applyPatch(const QString& sectorOffset, uint32_t byteOffset,
+                                 uint32_t size, const QString& value, uint32_t lun)
 {
-    LOG_INFO_CAT(TAG, QString("Erasing partition '%1' on LUN %2").arg(name).arg(lun));
+    LOG_DEBUG_CAT(TAG, QString("Patch LUN %1 sector %2 +%3 (%4 bytes) = %5")
+                     .arg(lun).arg(sectorOffset).arg(byteOffset).arg(size).arg(value));
 
-    auto partitions = readGptPartitions(lun);
-    const PartitionInfo* target = nullptr;
-    for (const auto& p : partitions) {
-        if (p.name.compare(name, Qt::CaseInsensitive) == 0) {
-            target = &p;
-            break;
-        }
-    }
-
-    if (!target) {
-        LOG_ERROR_CAT(TAG, QString("Partition '%1' not found for erase").arg(name));
-        return false;
-    }
+    // Patches rewrite GPT headers and CRCs
+    invalidatePartitionCache(lun);
 
-    QString xml = buildEraseXml(target->startSector, target->numSectors, m_sectorSize, lun);
+    QString xml = buildPatchXml(sectorOffset, byteOffset, size, value, lun);
     if (!sendXmlCommand(xml))
         return false;
 
-    FirehoseResponse resp = receiveXmlResponse(DATA_TIMEOUT_MS);
+    FirehoseResponse resp = receiveXmlResponse(XML_TIMEOUT_MS);
     if (!resp.success) {
-        LOG_ERROR_CAT(TAG, QString("Erase failed: %1").arg(resp.rawValue));
+        LOG_ERROR_CAT(TAG, QString("Patch failed: %1").arg(resp.rawValue));
         return false;
     }
-
-    LOG_INFO_CAT(TAG, QString("Partition '%1' erased").arg(name));
     return true;
 }
 
@@ -576,6 +816,7 @@ bool FirehoseClient::powerOff()
 bool FirehoseClient::setActiveSlot(const QString& slot)
 {
     LOG_INFO_CAT(TAG, QString("Setting active slot to '%1'").arg(slot));
+    invalidatePartitionCache();
 
     // Read all LUN partitions and patch the boot attributes
     // The active slot is controlled via partition attribute bits in GPT
@@ -599,6 +840,7 @@ bool FirehoseClient::setActiveSlot(const QString& slot)
 bool FirehoseClient::setBootableStorageDrive(uint32_t lun)
 {
     LOG_INFO_CAT(TAG, QString("Setting bootable storage drive LUN %1").arg(lun));
+    invalidatePartitionCache();
     QString xml = buildSetBootableXml(lun);
     if (!sendXmlCommand(xml))
         return false;
@@ -611,6 +853,8 @@ bool FirehoseClient::setBootableStorageDrive(uint32_t lun)
 
 FirehoseResponse FirehoseClient::sendRawXml(const QString& xml)
 {
+    // Arbitrary commands may rewrite the GPT behind our back
+    invalidatePartitionCache();
     if (!sendXmlCommand(xml))
         return {};
 
@@ -705,4 +949,197 @@ bool FirehoseClient::writeDataChunked(const QByteArray& data, ProgressCallback p
     return true;
 }
 
+// ─── Range transfer helpers ─────────────────────────────────────────
+
+// programRange only reports through its callback, so a sparse image can map
+// per-chunk progress onto the whole image; public entry points add the signal
+FirehoseClient::ProgressCallback FirehoseClient::withSignal(ProgressCallback progress)
+{
+    return [this, progress](qint64 current, qint64 total) {
+        if (progress)
+            progress(current, total);
+        emit transferProgress(current, total);
+    };
+}
+
+bool FirehoseClient::programRange(uint64_t startSector, uint64_t numSectors, uint32_t lun,
+                                   QIODevice* source, qint64 dataBytes,
+                                   ProgressCallback progress, const QString& startExpr)
+{
+    // A symbolic start cannot be split, and usually addresses the backup GPT
+    if (!startExpr.isEmpty())
+        invalidatePartitionCache(lun);
+    else
+        invalidateIfTouchesGpt(startSector, numSectors, lun);
+
+    const uint64_t perCommand = (m_sectorsPerCommand && startExpr.isEmpty())
+                                    ? m_sectorsPerCommand : numSectors;
+    const int transferSize = static_cast<int>(
+        qMax<uint32_t>(1, m_maxPayloadSize / m_sectorSize) * m_sectorSize);
+
+    qint64 consumed = 0;
+    int outstanding = 0;
+    bool allAck = true;
+    m_ackTail.clear();
+
+    // Fills one transfer from the source, zero-padding past its end so the
+    // last sector is complete. Runs on this thread while earlier transfers
+    // are still on the bus.
+    auto fill = [&](char* dst, qint64 maxSize) -> qint64 {
+        qint64 want = qBound<qint64>(0, dataBytes - consumed, maxSize);
+        qint64 got = 0;
+        while (got < want) {
+            qint64 r = source->read(dst + got, want - got);
+            if (r <= 0) break;
+            got += r;
+        }
+        if (got != want) {
+            LOG_ERROR_CAT(TAG, QString("Source read failed at offset %1: %2")
+                                   .arg(consumed).arg(source->errorString()));
+            return -1;
+        }
+        if (got < maxSize)
+            std::memset(dst + got, 0, maxSize - got);
+
+        consumed += got;
+        if (progress)
+            progress(consumed, dataBytes);
+        return maxSize;
+    };
+
+    for (uint64_t sector = 0; sector < numSectors; sector += perCommand) {
+        uint64_t count = qMin(perCommand, numSectors - sector);
+
+        QString xml = startExpr.isEmpty()
+                          ? buildProgramXml(startSector + sector, count, m_sectorSize, lun)
+                          : buildProgramXml(startExpr, count, m_sectorSize, lun);
+        if (!sendXmlCommand(xml)) {
+            LOG_ERROR_CAT(TAG, "Failed to send program command");
+            return false;
+        }
+
+        // Stream the command's data in payload-sized transfers
+        qint64 cmdBytes = static_cast<qint64>(count) * m_sectorSize;
+        if (m_transport->writeStream(cmdBytes, fill, transferSize, DATA_TIMEOUT_MS) != cmdBytes) {
+            LOG_ERROR_CAT(TAG, QString("Failed to write data at sector %1")
+                                   .arg(startSector + sector));
+            return false;
+        }
+
+        // Only block on ACKs once the window is full
+        ++outstanding;
+        while (outstanding >= m_commandWindow) {
+            int acked = receiveAcks(1, allAck, DATA_TIMEOUT_MS);
+            if (acked < 0 || !allAck) {
+                LOG_ERROR_CAT(TAG, QString("Program NAK/timeout near sector %1")
+                                       .arg(startSector + sector));
+                return false;
+            }
+            outstanding -= acked;
+        }
+    }
+
+    if (outstanding > 0) {
+        int acked = receiveAcks(outstanding, allAck, DATA_TIMEOUT_MS);
+        if (acked < 0 || !allAck) {
+            LOG_ERROR_CAT(TAG, "Program NAK/timeout on final ACK");
+            return false;
+        }
+    }
+    return true;
+}
+
+bool FirehoseClient::programFill(uint64_t startSector, uint64_t numSectors, uint32_t lun,
+                                  uint32_t fillValue, const std::function<void(qint64)>& advance)
+{
+    invalidateIfTouchesGpt(startSector, numSectors, lun);
+
+    // One payload-sized buffer holding the repeated pattern is sent as
+    // many times as the range needs
+    const int transferSize = static_cast<int>(
+        qMax<uint32_t>(1, m_maxPayloadSize / m_sectorSize) * m_sectorSize);
+    PooledBuffer pattern = BufferPool::instance().acquire(transferSize);
+    auto* words = reinterpret_cast<uint32_t*>(pattern.data());
+    for (int i = 0; i < transferSize / 4; ++i)
+        words[i] = fillValue;
+
+    QString xml = buildProgramXml(startSector, numSectors, m_sectorSize, lun);
+    if (!sendXmlCommand(xml)) {
+        LOG_ERROR_CAT(TAG, "Failed to send program command");
+        return false;
+    }
+
+    qint64 left = static_cast<qint64>(numSectors) * m_sectorSize;
+    while (left > 0) {
+        qint64 n = qMin<qint64>(transferSize, left);
+        if (m_transport->writeFrom(pattern.constData(), n) != n) {
+            LOG_ERROR_CAT(TAG, QString("Failed to write fill data at sector %1").arg(startSector));
+            return false;
+        }
+        left -= n;
+        advance(n);
+    }
+
+    FirehoseResponse resp = receiveXmlResponse(DATA_TIMEOUT_MS);
+    if (!resp.success) {
+        LOG_ERROR_CAT(TAG, QString("Fill NAK at sector %1: %2").arg(startSector).arg(resp.rawValue));
+        return false;
+    }
+    return true;
+}
+
+bool FirehoseClient::readRange(uint64_t startSector, uint64_t numSectors, uint32_t lun,
+                                QIODevice* sink, ProgressCallback progress)
+{
+    const uint64_t perCommand = m_sectorsPerCommand ? m_sectorsPerCommand : numSectors;
+    const qint64 transferSize = static_cast<qint64>(
+        qMax<uint32_t>(1, m_maxPayloadSize / m_sectorSize)) * m_sectorSize;
+    const qint64 totalBytes = static_cast<qint64>(numSectors) * m_sectorSize;
+
+    qint64 readSoFar = 0;
+    uint64_t issued = 0;            // sectors covered by commands sent so far
+
+    // One <read> at a time: the next command's raw sectors would otherwise
+    // follow the ACK directly and be swallowed by the response read
+    while (issued < numSectors) {
+        uint64_t count = qMin(perCommand, numSectors - issued);
+        QString xml = buildReadXml(startSector + issued, count, m_sectorSize, lun);
+        m_ackTail.clear();
+        if (!sendXmlCommand(xml)) {
+            LOG_ERROR_CAT(TAG, "Failed to send read command");
+            return false;
+        }
+        issued += count;
+
+        // Drain the command's data in payload-sized transfers; each block
+        // goes to the sink while later transfers are still queued
+        qint64 cmdBytes = static_cast<qint64>(count) * m_sectorSize;
+        qint64 got = m_transport->readStream(cmdBytes,
+            [&](const char* data, qint64 size) -> bool {
+                if (sink->write(data, size) != size) {
+                    LOG_ERROR_CAT(TAG, QString("Sink write failed: %1").arg(sink->errorString()));
+                    return false;
+                }
+                readSoFar += size;
+                if (progress)
+                    progress(readSoFar, totalBytes);
+                emit transferProgress(readSoFar, totalBytes);
+                return true;
+            }, static_cast<int>(transferSize), DATA_TIMEOUT_MS);
+        if (got != cmdBytes) {
+            LOG_ERROR_CAT(TAG, QString("readRange: expected %1 bytes, got %2")
+                                   .arg(cmdBytes).arg(got));
+            return false;
+        }
+
+        bool allAck = true;
+        if (receiveAcks(1, allAck, XML_TIMEOUT_MS) < 0 || !allAck) {
+            LOG_ERROR_CAT(TAG, QString("Read NAK/timeout near sector %1")
+                                   .arg(startSector + readSoFar / m_sectorSize));
+            return false;
+        }
+    }
+    return true;
+}
+
 } // namespace sakura
@@ -1,6 +1,8 @@
 #pragma once
 
 #include <QByteArray>
+#include <QHash>
+#include <QIODevice>
 #include <QList>
 #include <QObject>
 #include <QString>
@@ -49,14 +51,59 @@ public:
     uint32_t maxPayloadSize() const { return m_maxPayloadSize; }
     void setStorageType(FirehoseStorageType type) { m_storageType = type; }
 
+    // By default a contiguous range is moved with a single <program>/<read>
+    // and one final ACK. Loaders that cap the command size can be served
+    // by splitting into `sectors`-sized commands. Writes keep up to `window`
+    // commands in flight before the host waits for an ACK; reads always
+    // wait, since a pipelined read's data would follow the previous ACK.
+    void setSectorsPerCommand(uint64_t sectors) { m_sectorsPerCommand = sectors; }
+    uint64_t sectorsPerCommand() const { return m_sectorsPerCommand; }
+    void setCommandWindow(int window) { m_commandWindow = qMax(1, window); }
+    int commandWindow() const { return m_commandWindow; }
+
     // ── Partition operations ─────────────────────────────────────────
+    // Always reads the GPT from the device and refreshes the cached map
     QList<PartitionInfo> readGptPartitions(uint32_t lun = 0);
+
+    // Name lookup against the per-LUN map, which is read on first use and
+    // dropped when a write touches GPT sectors or the boot LUN changes
+    bool findPartition(const QString& name, uint32_t lun, PartitionInfo& out);
+    void invalidatePartitionCache();
+    void invalidatePartitionCache(uint32_t lun);
     QByteArray readPartition(const QString& name, uint32_t lun = 0,
                              ProgressCallback progress = nullptr);
+    // Writes each chunk to `sink` as soon as it arrives instead of
+    // accumulating the whole partition in memory.
+    bool readPartition(const QString& name, QIODevice* sink, uint32_t lun = 0,
+                       ProgressCallback progress = nullptr);
     bool writePartition(const QString& name, const QByteArray& data,
                         uint32_t lun = 0, ProgressCallback progress = nullptr);
+    // Streams from the current position of `source` to its end using a
+    // single reused payload buffer, so memory use is independent of size.
+    bool writePartition(const QString& name, QIODevice* source,
+                        uint32_t lun = 0, ProgressCallback progress = nullptr);
     bool erasePartition(const QString& name, uint32_t lun = 0);
 
+    // ── Sector-addressed operations ──────────────────────────────────
+    // Program `numSectors` starting at an absolute LBA, taking `dataBytes`
+    // from `source` and zero-padding the rest. No GPT lookup is involved.
+    bool programSectors(uint64_t startSector, uint64_t numSectors, uint32_t lun,
+                        QIODevice* source, qint64 dataBytes,
+                        ProgressCallback progress = nullptr);
+    // Same, with a start_sector expression evaluated by the loader
+    // (e.g. "NUM_DISK_SECTORS-5."); always sent as a single command.
+    bool programSectors(const QString& startSectorExpr, uint64_t numSectors, uint32_t lun,
+                        QIODevice* source, qint64 dataBytes,
+                        ProgressCallback progress = nullptr);
+    // Writes an Android sparse image chunk by chunk: RAW chunks become
+    // <program> commands, FILL chunks are sent from one repeated pattern
+    // buffer, and DONT_CARE ranges are skipped (or erased if requested).
+    bool programSparse(uint64_t startSector, uint32_t lun, QIODevice* sparseSource,
+                       bool eraseDontCare = false, ProgressCallback progress = nullptr);
+    bool applyPatch(const QString& sectorOffset, uint32_t byteOffset, uint32_t size,
+                    const QString& value, uint32_t lun);
+    uint32_t sectorSize() const { return m_sectorSize; }
+
     // ── Device control ───────────────────────────────────────────────
     bool reset();
     bool powerOff();
@@ -85,9 +132,12 @@ private:
     QString buildProgramXml(uint64_t startSector, uint64_t numSectors,
                             uint32_t sectorSize, uint32_t lun,
                             const QString& filename = QString());
+    QString buildProgramXml(const QString& startSector, uint64_t numSectors,
+                            uint32_t sectorSize, uint32_t lun,
+                            const QString& filename = QString());
     QString buildEraseXml(uint64_t startSector, uint64_t numSectors,
                           uint32_t sectorSize, uint32_t lun);
-    QString buildPatchXml(uint64_t sectorOffset, uint32_t byteOffset,
+    QString buildPatchXml(const QString& sectorOffset, uint32_t byteOffset,
                           uint32_t size, const QString& value, uint32_t lun);
     QString buildPowerXml(const QString& action);
     QString buildSetBootableXml(uint32_t lun);
@@ -97,13 +147,36 @@ private:
     FirehoseResponse receiveXmlResponse(int timeoutMs = 10000);
     FirehoseResponse parseResponse(const QByteArray& data);
 
+    int receiveAcks(int minCount, bool& allAck, int timeoutMs);
+
     // ── Transfer helpers ─────────────────────────────────────────────
     bool writeDataChunked(const QByteArray& data, ProgressCallback progress);
+    ProgressCallback withSignal(ProgressCallback progress);
+    bool programRange(uint64_t startSector, uint64_t numSectors, uint32_t lun,
+                      QIODevice* source, qint64 dataBytes, ProgressCallback progress,
+                      const QString& startExpr = QString());
+    bool programFill(uint64_t startSector, uint64_t numSectors, uint32_t lun,
+                     uint32_t fillValue, const std::function<void(qint64)>& advance);
+    bool readRange(uint64_t startSector, uint64_t numSectors, uint32_t lun,
+                   QIODevice* sink, ProgressCallback progress);
+
+    // ── Partition map cache ──────────────────────────────────────────
+    struct LunPartitionMap {
+        QList<PartitionInfo> partitions;
+        QHash<QString, int> indexByName;    // lower-cased name → index
+        uint64_t firstUsableLba = 0;
+        uint64_t lastUsableLba = 0;
+    };
+    void invalidateIfTouchesGpt(uint64_t startSector, uint64_t numSectors, uint32_t lun);
 
     ITransport* m_transport = nullptr;
+    QHash<uint32_t, LunPartitionMap> m_partitionCache;
     FirehoseStorageType m_storageType = FirehoseStorageType::UFS;
     uint32_t m_maxPayloadSize = 1048576;  // 1 MB default
     uint32_t m_sectorSize = 512;
+    uint64_t m_sectorsPerCommand = 0;     // 0 = whole range in one command
+    int m_commandWindow = 1;
+    QByteArray m_ackTail;                 // partial tag left over by receiveAcks
 
     static constexpr int XML_TIMEOUT_MS = 10000;
     static constexpr int DATA_TIMEOUT_MS = 60000;
@@ -2,6 +2,10 @@
 #include "qualcomm/auth/i_auth_strategy.h"
 #include "transport/i_transport.h"
 #include "core/logger.h"
+#include "common/sparse_stream.h"
+
+#include <QFile>
+#include <cstring>
 
 static const QString TAG = QStringLiteral("QualcommService");
 
@@ -205,6 +209,17 @@ QByteArray QualcommService::readPartition(const QString& name, uint32_t lun,
     return m_firehose->readPartition(name, lun, progress);
 }
 
+bool QualcommService::readPartition(const QString& name, QIODevice* sink, uint32_t lun,
+                                     ProgressCallback progress)
+{
+    if (!m_firehose) {
+        emit errorOccurred("Not connected");
+        return false;
+    }
+
+    return m_firehose->readPartition(name, sink, lun, progress);
+}
+
 bool QualcommService::writePartition(const QString& name, const QByteArray& data,
                                       uint32_t lun, ProgressCallback progress)
 {
@@ -216,6 +231,17 @@ bool QualcommService::writePartition(const QString& name, const QByteArray& data
     return m_firehose->writePartition(name, data, lun, progress);
 }
 
+bool QualcommService::writePartition(const QString& name, QIODevice* source,
+                                      uint32_t lun, ProgressCallback progress)
+{
+    if (!m_firehose) {
+        emit errorOccurred("Not connected");
+        return false;
+    }
+
+    return m_firehose->writePartition(name, source, lun, progress);
+}
+
 bool QualcommService::erasePartition(const QString& name, uint32_t lun)
 {
     if (!m_firehose) {
@@ -226,6 +252,100 @@ bool QualcommService::erasePartition(const QString& name, uint32_t lun)
     return m_firehose->erasePartition(name, lun);
 }
 
+// ─── Rawprogram execution ────────────────────────────────────────────
+
+bool QualcommService::programEntry(const RawprogramEntry& entry, const QString& filePath,
+                                    ProgressCallback progress)
+{
+    if (!m_firehose) {
+        emit errorOccurred("Not connected");
+        return false;
+    }
+
+    QFile file(filePath);
+    if (!file.open(QIODevice::ReadOnly)) {
+        LOG_ERROR_CAT(TAG, QString("Cannot open %1").arg(filePath));
+        return false;
+    }
+
+    const uint32_t sectorSize = m_firehose->sectorSize();
+    if (entry.sectorSize != 0 && entry.sectorSize != sectorSize) {
+        LOG_ERROR_CAT(TAG, QString("'%1': rawprogram sector size %2 != device %3")
+                              .arg(entry.label).arg(entry.sectorSize).arg(sectorSize));
+        return false;
+    }
+
+    const bool isSparse = entry.sparse && SparseStream::isSparseFile(filePath);
+    bool numericStart = true;
+    uint64_t startSector = entry.startSector;
+    if (!entry.startSectorExpr.isEmpty())
+        startSector = entry.startSectorExpr.toULongLong(&numericStart);
+
+    // Sparse images at a fixed LBA go chunk by chunk, so DONT_CARE
+    // regions never cross the wire
+    if (isSparse && numericStart) {
+        SparseHeader hdr;
+        QByteArray head = file.peek(sizeof(SparseHeader));
+        std::memcpy(&hdr, head.constData(), sizeof(SparseHeader));
+        uint64_t rawSectors = (static_cast<uint64_t>(hdr.totalBlocks) * hdr.blockSize
+                               + sectorSize - 1) / sectorSize;
+        if (entry.numSectors != 0 && rawSectors > entry.numSectors) {
+            LOG_ERROR_CAT(TAG, QString("'%1': sparse image needs %2 sectors, entry allows %3")
+                                  .arg(entry.label).arg(rawSectors).arg(entry.numSectors));
+            return false;
+        }
+        return m_firehose->programSparse(startSector, entry.physicalPartition, &file,
+                                         false, progress);
+    }
+
+    QIODevice* source = &file;
+    qint64 dataBytes = file.size();
+
+    SparseRawDevice sparse(&file);
+    if (isSparse) {
+        if (!sparse.open(QIODevice::ReadOnly)) {
+            LOG_ERROR_CAT(TAG, QString("%1: %2").arg(filePath, sparse.errorString()));
+            return false;
+        }
+        source = &sparse;
+        dataBytes = sparse.size();
+    }
+
+    uint64_t numSectors = (dataBytes + sectorSize - 1) / sectorSize;
+    if (entry.numSectors != 0 && numSectors > entry.numSectors) {
+        LOG_ERROR_CAT(TAG, QString("'%1': image needs %2 sectors, entry allows %3")
+                              .arg(entry.label).arg(numSectors).arg(entry.numSectors));
+        return false;
+    }
+
+    QString start = entry.startSectorExpr.isEmpty()
+                        ? QString::number(entry.startSector) : entry.startSectorExpr;
+    return m_firehose->programSectors(start, numSectors, entry.physicalPartition,
+                                      source, dataBytes, progress);
+}
+
+bool QualcommService::applyPatches(const QList<PatchEntry>& patches)
+{
+    if (!m_firehose) {
+        emit errorOccurred("Not connected");
+        return false;
+    }
+
+    bool allOk = true;
+    for (const auto& patch : patches) {
+        // Non-DISK patches target host-side files, not the device
+        if (patch.filename.compare("DISK", Qt::CaseInsensitive) != 0)
+            continue;
+
+        QString offset = patch.sectorOffsetExpr.isEmpty()
+                             ? QString::number(patch.sectorOffset) : patch.sectorOffsetExpr;
+        if (!m_firehose->applyPatch(offset, patch.byteOffset, patch.sizeInBytes,
+                                    patch.value, patch.physicalPartition))
+            allOk = false;
+    }
+    return allOk;
+}
+
 // ─── Device control ──────────────────────────────────────────────────
 
 bool QualcommService::reboot()
@@ -10,6 +10,7 @@
 #include "common/partition_info.h"
 #include "qualcomm/protocol/sahara_protocol.h"
 #include "qualcomm/protocol/firehose_client.h"
+#include "qualcomm/parsers/rawprogram_parser.h"
 
 namespace sakura {
 
@@ -53,10 +54,22 @@ public:
     QList<PartitionInfo> readPartitions(uint32_t lun = 0);
     QByteArray readPartition(const QString& name, uint32_t lun = 0,
                              ProgressCallback progress = nullptr);
+    bool readPartition(const QString& name, QIODevice* sink, uint32_t lun = 0,
+                       ProgressCallback progress = nullptr);
     bool writePartition(const QString& name, const QByteArray& data,
                         uint32_t lun = 0, ProgressCallback progress = nullptr);
+    bool writePartition(const QString& name, QIODevice* source,
+                        uint32_t lun = 0, ProgressCallback progress = nullptr);
     bool erasePartition(const QString& name, uint32_t lun = 0);
 
+    // ── Rawprogram execution ─────────────────────────────────────────
+    // Streams `filePath` straight to the entry's start sector (expanding
+    // sparse images on the fly); no GPT lookup is performed.
+    bool programEntry(const RawprogramEntry& entry, const QString& filePath,
+                      ProgressCallback progress = nullptr);
+    // Applies DISK patches in order; returns false if any of them failed
+    bool applyPatches(const QList<PatchEntry>& patches);
+
     // ── Device control ───────────────────────────────────────────────
     bool reboot();
     bool powerOff();
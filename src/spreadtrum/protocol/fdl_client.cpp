@@ -1,5 +1,6 @@
 #include "fdl_client.h"
 #include "spreadtrum/protocol/hdlc_protocol.h"
+#include "transport/buffer_pool.h"
 #include "transport/i_transport.h"
 #include "core/logger.h"
 
@@ -450,11 +451,20 @@ bool FdlClient::sendDataChunked(const QByteArray& data, uint32_t /*addr*/)
     const qint64 totalSize = data.size();
     const qint64 maxChunk = (MAX_PACKET_SIZE > 16) ? (MAX_PACKET_SIZE - 16) : 1;
 
+    // Every chunk is framed into the same two pooled buffers
+    const int maxPacket = static_cast<int>(maxChunk) + SprdHdlcProtocol::HEADER_SIZE
+                          + SprdHdlcProtocol::CHECKSUM_SIZE;
+    PooledBuffer frame = BufferPool::instance().acquire(2 * maxPacket + 2);
+    PooledBuffer scratch = BufferPool::instance().acquire(maxPacket);
+
     while (totalSent < totalSize) {
         int chunkLen = static_cast<int>(qMin<qint64>(maxChunk, totalSize - totalSent));
-        QByteArray chunk = data.mid(static_cast<int>(totalSent), chunkLen);
+        SprdHdlcProtocol::encodeInto(frame.bytes(), scratch.bytes(),
+                                     static_cast<uint16_t>(BslCommand::MIDST_DATA),
+                                     data.constData() + totalSent, chunkLen,
+                                     m_transcodeEnabled);
 
-        if (!sendCommand(BslCommand::MIDST_DATA, chunk)) {
+        if (m_transport->writeFrom(frame.constData(), frame.size()) != frame.size()) {
             LOG_ERROR_CAT(LOG_TAG, "Failed to send data chunk");
             return false;
         }
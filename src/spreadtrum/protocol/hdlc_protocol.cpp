@@ -2,6 +2,7 @@
 #include "common/crc_utils.h"
 
 #include <QtEndian>
+#include <cstring>
 
 namespace sakura {
 
@@ -24,6 +25,36 @@ QByteArray SprdHdlcProtocol::encode(uint16_t type, const QByteArray& payload,
     return SprdHdlc::encode(type, payload, transcode);
 }
 
+void SprdHdlcProtocol::encodeInto(QByteArray& frame, QByteArray& scratch, uint16_t type,
+                                  const char* payload, int size, bool transcode)
+{
+    const int packetSize = HEADER_SIZE + size + CHECKSUM_SIZE;
+    scratch.resize(packetSize);
+    auto* packet = reinterpret_cast<uchar*>(scratch.data());
+    qToBigEndian(type, packet);
+    qToBigEndian(static_cast<uint16_t>(size), packet + 2);
+    std::memcpy(packet + HEADER_SIZE, payload, static_cast<size_t>(size));
+    qToBigEndian(Crc16::sprdChecksum(packet, static_cast<size_t>(HEADER_SIZE + size)),
+                 packet + HEADER_SIZE + size);
+
+    // Worst case every byte is escaped
+    frame.resize(2 + (transcode ? 2 * packetSize : packetSize));
+    auto* out = reinterpret_cast<uchar*>(frame.data());
+    int n = 0;
+    out[n++] = HDLC_FLAG;
+    for (int i = 0; i < packetSize; ++i) {
+        const uchar b = packet[i];
+        if (transcode && (b == HDLC_FLAG || b == HDLC_ESCAPE)) {
+            out[n++] = HDLC_ESCAPE;
+            out[n++] = b ^ HDLC_ESCAPE_XOR;
+        } else {
+            out[n++] = b;
+        }
+    }
+    out[n++] = HDLC_FLAG;
+    frame.resize(n);
+}
+
 QByteArray SprdHdlcProtocol::decode(const QByteArray& data, bool transcode)
 {
     if (data.isEmpty())
@@ -27,6 +27,12 @@ public:
     static QByteArray encode(uint16_t type, const QByteArray& payload,
                              bool transcode = true);
 
+    // Same framing written into caller-owned buffers: `scratch` receives the
+    // raw packet, `frame` the result. Once both have grown to the largest
+    // frame, repeated calls do not allocate.
+    static void encodeInto(QByteArray& frame, QByteArray& scratch, uint16_t type,
+                           const char* payload, int size, bool transcode = true);
+
     // Decode a received response packet
     static QByteArray decode(const QByteArray& data, bool transcode = true);
 
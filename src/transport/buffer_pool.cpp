@@ -0,0 +1,94 @@
+#include "buffer_pool.h"
+
+namespace sakura {
+
+// ─── PooledBuffer ────────────────────────────────────────────────────
+
+PooledBuffer::~PooledBuffer()
+{
+    release();
+}
+
+PooledBuffer::PooledBuffer(PooledBuffer&& other) noexcept
+    : m_pool(other.m_pool)
+    , m_bytes(std::move(other.m_bytes))
+{
+    other.m_pool = nullptr;
+}
+
+PooledBuffer& PooledBuffer::operator=(PooledBuffer&& other) noexcept
+{
+    if (this != &other) {
+        release();
+        m_pool = other.m_pool;
+        m_bytes = std::move(other.m_bytes);
+        other.m_pool = nullptr;
+    }
+    return *this;
+}
+
+void PooledBuffer::release()
+{
+    if (m_pool)
+        m_pool->recycle(std::move(m_bytes));
+    m_pool = nullptr;
+    m_bytes = QByteArray();
+}
+
+// ─── BufferPool ──────────────────────────────────────────────────────
+
+BufferPool& BufferPool::instance()
+{
+    static BufferPool inst;
+    return inst;
+}
+
+PooledBuffer BufferPool::acquire(int size)
+{
+    QByteArray bytes;
+    {
+        QMutexLocker lock(&m_mutex);
+        // Smallest free buffer that already has room
+        int best = -1;
+        for (int i = 0; i < m_free.size(); ++i) {
+            if (m_free[i].capacity() >= size &&
+                (best < 0 || m_free[i].capacity() < m_free[best].capacity()))
+                best = i;
+        }
+        if (best >= 0)
+            bytes = m_free.takeAt(best);
+    }
+
+    if (bytes.capacity() < size)
+        bytes.reserve(size);
+    bytes.resize(size);
+    return PooledBuffer(this, std::move(bytes));
+}
+
+void BufferPool::trim()
+{
+    QMutexLocker lock(&m_mutex);
+    m_free.clear();
+}
+
+void BufferPool::recycle(QByteArray&& bytes)
+{
+    // Buffers still shared with a caller's copy are not reusable in place
+    if (bytes.isNull() || !bytes.isDetached())
+        return;
+
+    QMutexLocker lock(&m_mutex);
+    if (m_free.size() >= MAX_FREE_BUFFERS) {
+        // Keep the larger buffers; they are the expensive ones to rebuild
+        int smallest = 0;
+        for (int i = 1; i < m_free.size(); ++i)
+            if (m_free[i].capacity() < m_free[smallest].capacity())
+                smallest = i;
+        if (m_free[smallest].capacity() >= bytes.capacity())
+            return;
+        m_free.removeAt(smallest);
+    }
+    m_free.append(std::move(bytes));
+}
+
+} // namespace sakura
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <QByteArray>
+#include <QList>
+#include <QMutex>
+
+namespace sakura {
+
+class BufferPool;
+
+// Transfer buffer borrowed from a BufferPool. The storage goes back to the
+// pool when the object is destroyed, so hot loops reuse the same few
+// allocations instead of creating a QByteArray per chunk.
+class PooledBuffer {
+public:
+    PooledBuffer() = default;
+    ~PooledBuffer();
+
+    PooledBuffer(PooledBuffer&& other) noexcept;
+    PooledBuffer& operator=(PooledBuffer&& other) noexcept;
+    PooledBuffer(const PooledBuffer&) = delete;
+    PooledBuffer& operator=(const PooledBuffer&) = delete;
+
+    char* data() { return m_bytes.data(); }
+    const char* constData() const { return m_bytes.constData(); }
+    int size() const { return m_bytes.size(); }
+    bool isNull() const { return m_bytes.isNull(); }
+
+    // Shrinking keeps the capacity, so the buffer can be re-grown up to
+    // its original size without reallocating
+    void resize(int size) { m_bytes.resize(size); }
+
+    QByteArray& bytes() { return m_bytes; }
+
+private:
+    friend class BufferPool;
+    PooledBuffer(BufferPool* pool, QByteArray&& bytes)
+        : m_pool(pool), m_bytes(std::move(bytes)) {}
+
+    void release();
+
+    BufferPool* m_pool = nullptr;
+    QByteArray m_bytes;
+};
+
+class BufferPool {
+public:
+    static BufferPool& instance();
+
+    PooledBuffer acquire(int size);
+    void trim();
+
+private:
+    friend class PooledBuffer;
+    BufferPool() = default;
+
+    void recycle(QByteArray&& bytes);
+
+    QMutex m_mutex;
+    QList<QByteArray> m_free;
+
+    static constexpr int MAX_FREE_BUFFERS = 8;
+};
+
+} // namespace sakura
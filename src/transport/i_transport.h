@@ -1,8 +1,11 @@
 #pragma once
 
+#include "buffer_pool.h"
+
 #include <QByteArray>
 #include <QString>
 #include <cstdint>
+#include <cstring>
 #include <functional>
 
 namespace sakura {
@@ -26,6 +29,78 @@ public:
     virtual QByteArray read(int maxSize, int timeoutMs = 5000) = 0;
     virtual QByteArray readExact(int size, int timeoutMs = 5000) = 0;
 
+    // ── Span I/O ─────────────────────────────────────────────────────
+    // Caller-owned buffers for hot paths. readInto() fills exactly `size`
+    // bytes unless it times out and returns the count actually read (or
+    // -1 on error). Transports override these to skip the intermediate
+    // QByteArray.
+    virtual qint64 writeFrom(const char* src, qint64 size) {
+        return write(QByteArray::fromRawData(src, static_cast<int>(size)));
+    }
+
+    virtual qint64 readInto(char* dst, qint64 size, int timeoutMs = 5000) {
+        QByteArray chunk = readExact(static_cast<int>(size), timeoutMs);
+        std::memcpy(dst, chunk.constData(), chunk.size());
+        return chunk.size();
+    }
+
+    // ── Streaming ────────────────────────────────────────────────────
+    // Moves `total` bytes as a continuous stream. `fill` writes up to
+    // maxSize bytes into dst and returns the count (0 = no more data,
+    // <0 = error); `drain` consumes each received block. Both return the
+    // number of bytes transferred, or -1 on failure. The defaults run on
+    // write()/readExact(); transports with queued I/O override them to
+    // keep the bus busy between transfers.
+    using FillCallback = std::function<qint64(char* dst, qint64 maxSize)>;
+    using DrainCallback = std::function<bool(const char* data, qint64 size)>;
+
+    virtual qint64 writeStream(qint64 total, const FillCallback& fill,
+                               int chunkSize = 1024 * 1024, int timeoutMs = 5000) {
+        PooledBuffer buffer = BufferPool::instance().acquire(
+            static_cast<int>(qMin<qint64>(chunkSize, total)));
+        qint64 sent = 0;
+        while (sent < total) {
+            qint64 n = fill(buffer.data(), qMin<qint64>(buffer.size(), total - sent));
+            if (n < 0) return -1;
+            if (n == 0) break;
+            if (writeFrom(buffer.constData(), n) != n) return -1;
+            sent += n;
+        }
+        Q_UNUSED(timeoutMs);
+        return sent;
+    }
+
+    // Sends caller memory in `chunkSize` transfers without copying it.
+    // Transports with queued I/O keep several of those transfers in
+    // flight; `progress` sees the running byte count after each one.
+    virtual qint64 writeSpan(const char* src, qint64 size, int chunkSize = 1024 * 1024,
+                             int timeoutMs = 5000,
+                             const std::function<void(qint64 current, qint64 total)>& progress = nullptr) {
+        qint64 sent = 0;
+        while (sent < size) {
+            qint64 n = writeFrom(src + sent, qMin<qint64>(chunkSize, size - sent));
+            if (n <= 0) return -1;
+            sent += n;
+            if (progress) progress(sent, size);
+        }
+        Q_UNUSED(timeoutMs);
+        return sent;
+    }
+
+    virtual qint64 readStream(qint64 total, const DrainCallback& drain,
+                              int chunkSize = 1024 * 1024, int timeoutMs = 5000) {
+        PooledBuffer buffer = BufferPool::instance().acquire(
+            static_cast<int>(qMin<qint64>(chunkSize, total)));
+        qint64 received = 0;
+        while (received < total) {
+            qint64 want = qMin<qint64>(buffer.size(), total - received);
+            if (readInto(buffer.data(), want, timeoutMs) != want) return -1;
+            if (!drain(buffer.constData(), want)) return -1;
+            received += want;
+        }
+        return received;
+    }
+
     virtual void flush() = 0;
     virtual void discardInput() = 0;
     virtual void discardOutput() = 0;
@@ -0,0 +1,287 @@
+#include "usb_async_engine.h"
+#include "core/logger.h"
+#include <QElapsedTimer>
+#include <QList>
+
+#include <libusb-1.0/libusb.h>
+
+namespace sakura {
+
+UsbAsyncEngine::UsbAsyncEngine(libusb_device_handle* handle, uint8_t endpoint,
+                               int depth, int transferSize)
+    : m_handle(handle)
+    , m_endpoint(endpoint)
+    , m_transferSize(transferSize)
+{
+    // Sized once: transfers keep a pointer to their slot as user_data
+    m_slots.resize(qMax(1, depth));
+    for (auto& slot : m_slots) {
+        slot.engine = this;
+        slot.transfer = libusb_alloc_transfer(0);
+        if (!slot.transfer) {
+            LOG_ERROR("libusb_alloc_transfer failed");
+            for (auto& s : m_slots)
+                if (s.transfer) libusb_free_transfer(s.transfer);
+            m_slots.clear();
+            return;
+        }
+    }
+}
+
+UsbAsyncEngine::~UsbAsyncEngine()
+{
+    cancelAll();
+    for (auto& slot : m_slots)
+        libusb_free_transfer(slot.transfer);
+}
+
+void UsbAsyncEngine::transferCallback(libusb_transfer* transfer)
+{
+    auto* slot = static_cast<Slot*>(transfer->user_data);
+    QMutexLocker lock(&slot->engine->m_mutex);
+    slot->busy = false;
+    slot->engine->m_done.wakeAll();
+}
+
+void UsbAsyncEngine::ensureBuffers()
+{
+    for (auto& slot : m_slots)
+        if (slot.buffer.size() != static_cast<size_t>(m_transferSize))
+            slot.buffer.resize(m_transferSize);
+}
+
+bool UsbAsyncEngine::submit(Slot& slot, unsigned char* buffer, int length, int timeoutMs)
+{
+    libusb_fill_bulk_transfer(slot.transfer, m_handle, m_endpoint,
+                              buffer, length,
+                              &UsbAsyncEngine::transferCallback, &slot,
+                              static_cast<unsigned int>(timeoutMs));
+    {
+        QMutexLocker lock(&m_mutex);
+        slot.busy = true;
+    }
+    int ret = libusb_submit_transfer(slot.transfer);
+    if (ret != 0) {
+        QMutexLocker lock(&m_mutex);
+        slot.busy = false;
+        LOG_ERROR(QString("libusb_submit_transfer: %1")
+                      .arg(libusb_strerror(static_cast<libusb_error>(ret))));
+        return false;
+    }
+    return true;
+}
+
+bool UsbAsyncEngine::waitFor(Slot& slot, int timeoutMs)
+{
+    // The transfer carries its own libusb timeout; the extra margin only
+    // guards against an event thread that has stopped running
+    QElapsedTimer timer;
+    timer.start();
+    QMutexLocker lock(&m_mutex);
+    while (slot.busy) {
+        qint64 left = timeoutMs + 1000 - timer.elapsed();
+        if (left <= 0)
+            return false;
+        m_done.wait(&m_mutex, static_cast<unsigned long>(left));
+    }
+    return true;
+}
+
+void UsbAsyncEngine::cancelAll()
+{
+    for (auto& slot : m_slots) {
+        bool busy;
+        {
+            QMutexLocker lock(&m_mutex);
+            busy = slot.busy;
+        }
+        if (busy)
+            libusb_cancel_transfer(slot.transfer);
+    }
+    for (auto& slot : m_slots)
+        waitFor(slot, 1000);
+}
+
+qint64 UsbAsyncEngine::write(qint64 total, const ITransport::FillCallback& fill,
+                             int timeoutMs)
+{
+    ensureBuffers();
+
+    QList<Slot*> pending;   // submission order == completion order
+    qint64 filled = 0;
+    qint64 completed = 0;
+    bool exhausted = false;
+
+    auto refill = [&](Slot& slot) -> bool {
+        if (exhausted || filled >= total)
+            return true;
+        qint64 len = fill(reinterpret_cast<char*>(slot.buffer.data()),
+                          qMin<qint64>(m_transferSize, total - filled));
+        if (len < 0)
+            return false;
+        if (len == 0) {
+            exhausted = true;
+            return true;
+        }
+        if (!submit(slot, slot.buffer.data(), static_cast<int>(len), timeoutMs))
+            return false;
+        filled += len;
+        pending.append(&slot);
+        return true;
+    };
+
+    for (auto& slot : m_slots) {
+        if (!refill(slot)) {
+            cancelAll();
+            return -1;
+        }
+    }
+
+    while (!pending.isEmpty()) {
+        Slot& slot = *pending.takeFirst();
+        if (!waitFor(slot, timeoutMs)) {
+            LOG_ERROR("USB async write: completion timed out");
+            cancelAll();
+            return -1;
+        }
+
+        libusb_transfer* t = slot.transfer;
+        if (t->status != LIBUSB_TRANSFER_COMPLETED || t->actual_length != t->length) {
+            LOG_ERROR(QString("USB async write failed: status=%1, %2/%3 bytes")
+                          .arg(t->status).arg(t->actual_length).arg(t->length));
+            cancelAll();
+            return -1;
+        }
+        completed += t->actual_length;
+
+        if (!refill(slot)) {
+            cancelAll();
+            return -1;
+        }
+    }
+    return completed;
+}
+
+qint64 UsbAsyncEngine::writeSpan(const char* data, qint64 total, int timeoutMs,
+                                 const std::function<void(qint64, qint64)>& progress)
+{
+    QList<Slot*> pending;   // submission order == completion order
+    qint64 submitted = 0;
+    qint64 completed = 0;
+
+    auto submitNext = [&](Slot& slot) -> bool {
+        if (submitted >= total)
+            return true;
+        int len = static_cast<int>(qMin<qint64>(m_transferSize, total - submitted));
+        // libusb only reads from OUT buffers, the cast is safe
+        auto* buffer = reinterpret_cast<unsigned char*>(const_cast<char*>(data + submitted));
+        if (!submit(slot, buffer, len, timeoutMs))
+            return false;
+        submitted += len;
+        pending.append(&slot);
+        return true;
+    };
+
+    for (auto& slot : m_slots) {
+        if (!submitNext(slot)) {
+            cancelAll();
+            return -1;
+        }
+    }
+
+    while (!pending.isEmpty()) {
+        Slot& slot = *pending.takeFirst();
+        if (!waitFor(slot, timeoutMs)) {
+            LOG_ERROR("USB async write: completion timed out");
+            cancelAll();
+            return -1;
+        }
+
+        libusb_transfer* t = slot.transfer;
+        if (t->status != LIBUSB_TRANSFER_COMPLETED || t->actual_length != t->length) {
+            LOG_ERROR(QString("USB async write failed: status=%1, %2/%3 bytes")
+                          .arg(t->status).arg(t->actual_length).arg(t->length));
+            cancelAll();
+            return -1;
+        }
+        completed += t->actual_length;
+        if (progress)
+            progress(completed, total);
+
+        if (!submitNext(slot)) {
+            cancelAll();
+            return -1;
+        }
+    }
+    return completed;
+}
+
+qint64 UsbAsyncEngine::read(qint64 total, const ITransport::DrainCallback& drain,
+                            int timeoutMs)
+{
+    ensureBuffers();
+
+    QList<Slot*> pending;   // submission order == completion order
+    qint64 requested = 0;   // bytes covered by transfers still in flight
+    qint64 received = 0;
+
+    auto resubmit = [&](Slot& slot) -> bool {
+        qint64 len = qMin<qint64>(m_transferSize, total - received - requested);
+        if (len <= 0)
+            return true;
+        if (!submit(slot, slot.buffer.data(), static_cast<int>(len), timeoutMs))
+            return false;
+        requested += len;
+        pending.append(&slot);
+        return true;
+    };
+
+    QList<Slot*> idle;
+    for (auto& slot : m_slots) {
+        if (!resubmit(slot)) {
+            cancelAll();
+            return -1;
+        }
+        if (pending.isEmpty() || pending.last() != &slot)
+            idle.append(&slot);
+    }
+
+    while (!pending.isEmpty()) {
+        Slot& slot = *pending.takeFirst();
+        if (!waitFor(slot, timeoutMs)) {
+            LOG_ERROR("USB async read: completion timed out");
+            cancelAll();
+            return -1;
+        }
+
+        libusb_transfer* t = slot.transfer;
+        requested -= t->length;
+        if (t->status != LIBUSB_TRANSFER_COMPLETED) {
+            LOG_ERROR(QString("USB async read failed: status=%1").arg(t->status));
+            cancelAll();
+            return -1;
+        }
+
+        if (t->actual_length > 0) {
+            if (!drain(reinterpret_cast<const char*>(slot.buffer.data()), t->actual_length)) {
+                cancelAll();
+                return -1;
+            }
+            received += t->actual_length;
+        }
+
+        // A short packet ends its URB early; the shortfall is requested
+        // again through this slot and any that were left idle
+        idle.prepend(&slot);
+        while (!idle.isEmpty() && received + requested < total) {
+            Slot* next = idle.takeFirst();
+            if (!resubmit(*next)) {
+                cancelAll();
+                return -1;
+            }
+        }
+    }
+    return received;
+}
+
+} // namespace sakura
@@ -0,0 +1,62 @@
+#pragma once
+
+#include "i_transport.h"
+#include <QMutex>
+#include <QWaitCondition>
+#include <cstdint>
+#include <vector>
+
+struct libusb_device_handle;
+struct libusb_transfer;
+
+namespace sakura {
+
+// Ring of pre-allocated bulk transfers on one endpoint. Up to `depth`
+// transfers are kept submitted at once so the host controller always has
+// the next URB queued when the previous one completes. Completion
+// callbacks are delivered by the owning transport's event thread.
+// Staging buffers are only allocated for the callback-driven write()/read();
+// writeSpan() points its transfers at the caller's memory.
+class UsbAsyncEngine {
+public:
+    UsbAsyncEngine(libusb_device_handle* handle, uint8_t endpoint,
+                   int depth, int transferSize);
+    ~UsbAsyncEngine();
+
+    UsbAsyncEngine(const UsbAsyncEngine&) = delete;
+    UsbAsyncEngine& operator=(const UsbAsyncEngine&) = delete;
+
+    bool isValid() const { return !m_slots.empty(); }
+    int depth() const { return static_cast<int>(m_slots.size()); }
+    int transferSize() const { return m_transferSize; }
+
+    qint64 write(qint64 total, const ITransport::FillCallback& fill, int timeoutMs);
+    qint64 read(qint64 total, const ITransport::DrainCallback& drain, int timeoutMs);
+    qint64 writeSpan(const char* data, qint64 total, int timeoutMs,
+                     const std::function<void(qint64, qint64)>& progress);
+
+private:
+    struct Slot {
+        UsbAsyncEngine* engine = nullptr;
+        libusb_transfer* transfer = nullptr;
+        std::vector<unsigned char> buffer;
+        bool busy = false;
+    };
+
+    void ensureBuffers();
+    bool submit(Slot& slot, unsigned char* buffer, int length, int timeoutMs);
+    bool waitFor(Slot& slot, int timeoutMs);
+    void cancelAll();
+
+    static void transferCallback(libusb_transfer* transfer);
+
+    libusb_device_handle* m_handle = nullptr;
+    uint8_t m_endpoint = 0;
+    int m_transferSize = 0;
+    std::vector<Slot> m_slots;
+
+    QMutex m_mutex;
+    QWaitCondition m_done;
+};
+
+} // namespace sakura
@@ -1,6 +1,8 @@
 #include "usb_transport.h"
+#include "usb_async_engine.h"
 #include "core/logger.h"
 #include <QElapsedTimer>
+#include <QThread>
 
 // libusb header - adjust path based on your installation
 #include <libusb-1.0/libusb.h>
@@ -75,6 +77,8 @@ bool UsbTransport::openByVidPid(uint16_t vid, uint16_t pid)
     if (!findEndpoints())
         return false;
 
+    startEventThread();
+
     LOG_INFO(QString("USB device opened: VID=%1 PID=%2")
                  .arg(vid, 4, 16, QChar('0')).arg(pid, 4, 16, QChar('0')));
     return true;
@@ -82,8 +86,16 @@ bool UsbTransport::openByVidPid(uint16_t vid, uint16_t pid)
 
 void UsbTransport::close()
 {
+    QMutexLocker outLock(&m_asyncOutMutex);
+    QMutexLocker inLock(&m_asyncInMutex);
     QMutexLocker lock(&m_mutex);
     if (m_handle) {
+        // Outstanding transfers are cancelled while the event thread can
+        // still deliver their completions
+        m_asyncIn.reset();
+        m_asyncOut.reset();
+        stopEventThread();
+
         // Reset the device before closing to prevent the device from
         // being locked in a claimed state. Without this, some devices
         // (especially MTK) may require a system restart to reconnect.
@@ -107,19 +119,34 @@ bool UsbTransport::isOpen() const
 }
 
 qint64 UsbTransport::write(const QByteArray& data)
+{
+    return writeFrom(data.constData(), data.size());
+}
+
+qint64 UsbTransport::writeFrom(const char* src, qint64 size)
 {
     QMutexLocker lock(&m_mutex);
     if (!m_handle) return -1;
 
-    int transferred = 0;
-    int ret = libusb_bulk_transfer(m_handle, m_epOut,
-                                    const_cast<unsigned char*>(reinterpret_cast<const unsigned char*>(data.data())),
-                                    data.size(), &transferred, 5000);
-    if (ret != 0) {
-        LOG_ERROR(QString("USB write error: %1").arg(libusb_strerror(static_cast<libusb_error>(ret))));
-        return -1;
+    // Sent straight from the caller's memory; very large spans are split
+    // only to keep each libusb length within int range
+    constexpr qint64 MAX_TRANSFER = 16 * 1024 * 1024;
+    qint64 sent = 0;
+    while (sent < size) {
+        int len = static_cast<int>(qMin(MAX_TRANSFER, size - sent));
+        int transferred = 0;
+        int ret = libusb_bulk_transfer(m_handle, m_epOut,
+                                        const_cast<unsigned char*>(reinterpret_cast<const unsigned char*>(src + sent)),
+                                        len, &transferred, 5000);
+        if (ret != 0) {
+            LOG_ERROR(QString("USB write error: %1").arg(libusb_strerror(static_cast<libusb_error>(ret))));
+            return -1;
+        }
+        sent += transferred;
+        if (transferred != len)
+            break;
     }
-    return transferred;
+    return sent;
 }
 
 QByteArray UsbTransport::read(int maxSize, int timeoutMs)
@@ -142,21 +169,125 @@ QByteArray UsbTransport::read(int maxSize, int timeoutMs)
 
 QByteArray UsbTransport::readExact(int size, int timeoutMs)
 {
-    QByteArray result;
-    result.reserve(size);
+    QByteArray result(size, Qt::Uninitialized);
+    qint64 got = readInto(result.data(), size, timeoutMs);
+    result.resize(static_cast<int>(qMax<qint64>(0, got)));
+    return result;
+}
+
+qint64 UsbTransport::readInto(char* dst, qint64 size, int timeoutMs)
+{
     QElapsedTimer timer;
     timer.start();
-
-    while (result.size() < size) {
-        if (timer.elapsed() > timeoutMs) break;
-        int remaining = size - result.size();
-        QByteArray chunk = read(remaining, qMin(1000, timeoutMs - static_cast<int>(timer.elapsed())));
-        if (!chunk.isEmpty())
-            result.append(chunk);
-        else
+    qint64 got = 0;
+
+    while (got < size) {
+        int left = timeoutMs - static_cast<int>(timer.elapsed());
+        if (left <= 0) break;
+
+        int transferred = 0;
+        int ret;
+        {
+            QMutexLocker lock(&m_mutex);
+            if (!m_handle) return got ? got : -1;
+            int len = static_cast<int>(qMin<qint64>(size - got, 16 * 1024 * 1024));
+            ret = libusb_bulk_transfer(m_handle, m_epIn,
+                                       reinterpret_cast<unsigned char*>(dst + got),
+                                       len, &transferred, qMin(1000, left));
+        }
+        if (ret != 0 && ret != LIBUSB_ERROR_TIMEOUT) {
+            LOG_ERROR(QString("USB read error: %1").arg(libusb_strerror(static_cast<libusb_error>(ret))));
+            break;
+        }
+        got += transferred;
+        if (transferred == 0)
             break;
     }
-    return result;
+    return got;
+}
+
+qint64 UsbTransport::writeStream(qint64 total, const FillCallback& fill,
+                                 int chunkSize, int timeoutMs)
+{
+    QMutexLocker engineLock(&m_asyncOutMutex);
+    UsbAsyncEngine* engine = nullptr;
+    {
+        QMutexLocker lock(&m_mutex);
+        if (!m_handle) return -1;
+        if (m_eventThread)
+            engine = asyncEngine(m_asyncOut, m_epOut, chunkSize);
+    }
+    if (engine)
+        return engine->write(total, fill, timeoutMs);
+    engineLock.unlock();
+    return ITransport::writeStream(total, fill, chunkSize, timeoutMs);
+}
+
+qint64 UsbTransport::writeSpan(const char* src, qint64 size, int chunkSize, int timeoutMs,
+                               const std::function<void(qint64, qint64)>& progress)
+{
+    QMutexLocker engineLock(&m_asyncOutMutex);
+    UsbAsyncEngine* engine = nullptr;
+    {
+        QMutexLocker lock(&m_mutex);
+        if (!m_handle) return -1;
+        if (m_eventThread)
+            engine = asyncEngine(m_asyncOut, m_epOut, chunkSize);
+    }
+    if (engine)
+        return engine->writeSpan(src, size, timeoutMs, progress);
+    engineLock.unlock();
+    return ITransport::writeSpan(src, size, chunkSize, timeoutMs, progress);
+}
+
+qint64 UsbTransport::readStream(qint64 total, const DrainCallback& drain,
+                                int chunkSize, int timeoutMs)
+{
+    QMutexLocker engineLock(&m_asyncInMutex);
+    UsbAsyncEngine* engine = nullptr;
+    {
+        QMutexLocker lock(&m_mutex);
+        if (!m_handle) return -1;
+        if (m_eventThread)
+            engine = asyncEngine(m_asyncIn, m_epIn, chunkSize);
+    }
+    if (engine)
+        return engine->read(total, drain, timeoutMs);
+    engineLock.unlock();
+    return ITransport::readStream(total, drain, chunkSize, timeoutMs);
+}
+
+UsbAsyncEngine* UsbTransport::asyncEngine(std::unique_ptr<UsbAsyncEngine>& engine,
+                                          uint8_t endpoint, int chunkSize)
+{
+    // Buffers are pre-allocated once and reused until the geometry changes
+    if (!engine || engine->transferSize() != chunkSize || engine->depth() != m_asyncDepth)
+        engine = std::make_unique<UsbAsyncEngine>(m_handle, endpoint, m_asyncDepth, chunkSize);
+    return engine->isValid() ? engine.get() : nullptr;
+}
+
+void UsbTransport::startEventThread()
+{
+    if (m_eventThread) return;
+
+    m_eventsRunning = true;
+    m_eventThread = QThread::create([this]() {
+        struct timeval tv = {0, 100000};
+        while (m_eventsRunning.load())
+            libusb_handle_events_timeout_completed(s_context, &tv, nullptr);
+    });
+    m_eventThread->setObjectName(QStringLiteral("usb-events"));
+    m_eventThread->start(QThread::TimeCriticalPriority);
+}
+
+void UsbTransport::stopEventThread()
+{
+    if (!m_eventThread) return;
+
+    m_eventsRunning = false;
+    m_eventThread->wait();
+    delete m_eventThread;
+    m_eventThread = nullptr;
 }
 
 void UsbTransport::flush() {}
@@ -175,10 +306,20 @@ QString UsbTransport::description() const
     return QString("USB[%1:%2]").arg(m_vid, 4, 16, QChar('0')).arg(m_pid, 4, 16, QChar('0'));
 }
 
+bool UsbTransport::isSuperSpeed() const
+{
+    if (!m_handle) return false;
+    return libusb_get_device_speed(libusb_get_device(m_handle)) >= LIBUSB_SPEED_SUPER;
+}
+
 void UsbTransport::setEndpoints(uint8_t epIn, uint8_t epOut)
 {
+    QMutexLocker outLock(&m_asyncOutMutex);
+    QMutexLocker inLock(&m_asyncInMutex);
     m_epIn = epIn;
     m_epOut = epOut;
+    m_asyncIn.reset();
+    m_asyncOut.reset();
 }
 
 bool UsbTransport::claimInterface()
@@ -2,13 +2,19 @@
 
 #include "i_transport.h"
 #include <QMutex>
+#include <atomic>
 #include <cstdint>
+#include <memory>
+
+class QThread;
 
 struct libusb_context;
 struct libusb_device_handle;
 
 namespace sakura {
 
+class UsbAsyncEngine;
+
 struct UsbDeviceInfo {
     uint16_t vid = 0;
     uint16_t pid = 0;
@@ -31,6 +37,19 @@ public:
     QByteArray read(int maxSize, int timeoutMs = 5000) override;
     QByteArray readExact(int size, int timeoutMs = 5000) override;
 
+    qint64 writeFrom(const char* src, qint64 size) override;
+    qint64 readInto(char* dst, qint64 size, int timeoutMs = 5000) override;
+
+    // Streams through a ring of queued async bulk transfers
+    qint64 writeStream(qint64 total, const FillCallback& fill,
+                       int chunkSize = 1024 * 1024, int timeoutMs = 5000) override;
+    qint64 readStream(qint64 total, const DrainCallback& drain,
+                      int chunkSize = 1024 * 1024, int timeoutMs = 5000) override;
+    // Queues transfers that point straight into `src`
+    qint64 writeSpan(const char* src, qint64 size, int chunkSize = 1024 * 1024,
+                     int timeoutMs = 5000,
+                     const std::function<void(qint64 current, qint64 total)>& progress = nullptr) override;
+
     void flush() override;
     void discardInput() override;
     void discardOutput() override;
@@ -41,6 +60,11 @@ public:
     // USB-specific
     bool openByVidPid(uint16_t vid, uint16_t pid);
     void setEndpoints(uint8_t epIn, uint8_t epOut);
+    bool isSuperSpeed() const;
+
+    // Number of bulk transfers kept in flight per streaming direction
+    void setAsyncQueueDepth(int depth) { m_asyncDepth = qMax(1, depth); }
+    int asyncQueueDepth() const { return m_asyncDepth; }
 
     static QList<UsbDeviceInfo> enumerateDevices(uint16_t vid = 0, uint16_t pid = 0);
     static bool initLibusb();
@@ -67,6 +91,10 @@ public:
 private:
     bool claimInterface();
     bool findEndpoints();
+    void startEventThread();
+    void stopEventThread();
+    UsbAsyncEngine* asyncEngine(std::unique_ptr<UsbAsyncEngine>& engine,
+                                uint8_t endpoint, int chunkSize);
 
     uint16_t m_vid = 0;
     uint16_t m_pid = 0;
@@ -75,9 +103,20 @@ private:
     int m_interface = 0;
 
     libusb_device_handle* m_handle = nullptr;
+    int m_asyncDepth = 8;
+    std::unique_ptr<UsbAsyncEngine> m_asyncIn;
+    std::unique_ptr<UsbAsyncEngine> m_asyncOut;
+    QThread* m_eventThread = nullptr;
+    std::atomic<bool> m_eventsRunning{false};
+
     static libusb_context* s_context;
     static int s_refCount;
     QMutex m_mutex;
+    // Held for a whole async transfer instead of m_mutex, so callbacks and
+    // other threads can still use the synchronous calls meanwhile.
+    // Lock order: out, in, then m_mutex.
+    QMutex m_asyncOutMutex;
+    QMutex m_asyncInMutex;
 };
 
 } // namespace sakura